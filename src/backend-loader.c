@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "backend.h"
+
+/*
+ * Backend loader
+ *
+ * The combined executable contains everything that does not call GL. The
+ * backends are shared modules which link against their GLES library, so
+ * libGLESv1_CM and libGLESv2 are only loaded when a backend is requested.
+ * Modules are searched next to the executable first (build directory) and
+ * then in the installation directory, NIGHTMARE_BACKEND_DIR overrides both.
+ */
+
+#ifdef NIGHTMARE_USE_BACKENDS
+#include <dlfcn.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+
+static const char *default_names[MAX_BACKENDS] = {"gles1", "gles2"};
+static void *handles[MAX_BACKENDS];
+static size_t handle_count = 0;
+
+static void *open_module(const char *directory, const char *name)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/nightmare-backend-%s.so", directory, name);
+
+    return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+}
+
+static void *open_backend(const char *name)
+{
+    const char *override = getenv("NIGHTMARE_BACKEND_DIR");
+    if (override)
+    {
+        return open_module(override, name);
+    }
+
+    char executable[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    if (length > 0)
+    {
+        executable[length] = '\0';
+
+        void *handle = open_module(dirname(executable), name);
+        if (handle)
+        {
+            return handle;
+        }
+    }
+
+    return open_module(NIGHTMARE_BACKEND_DIR, name);
+}
+
+// Loads the named backends (all if count is 0), returns the number loaded or 0 on failure
+size_t load_backends(const struct Backend **backends, const char *const *names, size_t count)
+{
+    if (count == 0)
+    {
+        names = default_names;
+        count = MAX_BACKENDS;
+    }
+
+    for (size_t i = 0; i < count && i < MAX_BACKENDS; i++)
+    {
+        void *handle = open_backend(names[i]);
+        if (!handle)
+        {
+            print_error("Could not load backend '%s': %s\n", names[i], dlerror());
+            unload_backends();
+            return 0;
+        }
+
+        handles[handle_count++] = handle;
+
+        const struct Backend *backend = dlsym(handle, BACKEND_SYMBOL);
+        if (!backend)
+        {
+            print_error("Backend '%s' does not export %s\n", names[i], BACKEND_SYMBOL);
+            unload_backends();
+            return 0;
+        }
+
+        backends[i] = backend;
+    }
+
+    return handle_count;
+}
+
+void unload_backends()
+{
+    for (size_t i = 0; i < handle_count; i++)
+    {
+        dlclose(handles[i]);
+    }
+
+    handle_count = 0;
+}
+#endif
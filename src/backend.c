@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "backend.h"
+
+#include "common.h"
+#include "options.h"
+#include "program-cache.h"
+#include "scenes.h"
+#include "shader-benchmark.h"
+
+#ifdef NIGHTMARE_USE_GLES1
+#include <GLES/gl.h>
+#elif defined NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+#endif
+
+static const char *get_string(unsigned int name)
+{
+    return (const char *)glGetString(name);
+}
+
+static bool initialize()
+{
+    if (options.program_cache_path && !initialize_program_cache(options.program_cache_path))
+    {
+        print("Continuing without program cache\n\n");
+    }
+
+    return true;
+}
+
+static void cleanup()
+{
+    cleanup_program_cache();
+}
+
+const struct Backend nightmare_backend = {
+    .name = BACKEND_NAME,
+#ifdef NIGHTMARE_USE_GLES1
+    .renderable_type = EGL_OPENGL_ES_BIT,
+    .context_version = 1,
+#elif defined NIGHTMARE_USE_GLES2
+    .renderable_type = EGL_OPENGL_ES2_BIT,
+    .context_version = 2,
+#endif
+    .get_string = get_string,
+    .initialize = initialize,
+    .cleanup = cleanup,
+    .get_scene_count = get_scene_count,
+    .get_scene_name = get_scene_name,
+    .begin_scenes = begin_scenes,
+    .run_scene = run_scene_at,
+    .end_scenes = end_scenes,
+    .run_config_sweep = run_config_sweep,
+    .run_antialiasing_sweep = run_antialiasing_sweep,
+    .run_line_sweep = run_line_sweep,
+    .run_shader_benchmark = run_shader_benchmark,
+    .run_capacity_search = run_capacity_search,
+};
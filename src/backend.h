@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <EGL/egl.h>
+
+/*
+ * Rendering backends
+ *
+ * Everything that calls into GL is built once per API and exposes itself
+ * through a function table. The per API executables link their table
+ * directly, the combined executable loads the backend modules at runtime.
+ */
+
+#ifdef NIGHTMARE_USE_GLES1
+#define BACKEND_NAME "gles1"
+#elif defined NIGHTMARE_USE_GLES2
+#define BACKEND_NAME "gles2"
+#endif
+
+#define MAX_BACKENDS 2
+
+// Name the table is exported as by the backend modules
+#define BACKEND_SYMBOL "nightmare_backend"
+
+struct Backend
+{
+    const char *name;
+    // Framebuffer configurations have to support the renderable type
+    EGLint renderable_type;
+    EGLint context_version;
+    // glGetString
+    const char *(*get_string)(unsigned int name);
+    // Called with the context of the backend current
+    bool (*initialize)();
+    void (*cleanup)();
+    size_t (*get_scene_count)();
+    const char *(*get_scene_name)(size_t index);
+    bool (*begin_scenes)();
+    bool (*run_scene)(size_t index);
+    void (*end_scenes)();
+    bool (*run_config_sweep)();
+    bool (*run_antialiasing_sweep)();
+    bool (*run_line_sweep)();
+    bool (*run_shader_benchmark)();
+    bool (*run_capacity_search)();
+};
+
+#ifdef NIGHTMARE_USE_BACKENDS
+size_t load_backends(const struct Backend **backends, const char *const *names, size_t count);
+void unload_backends();
+#else
+extern const struct Backend nightmare_backend;
+#endif
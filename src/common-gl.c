@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "gl-resources.h"
+#include "program-cache.h"
+
+/*
+ * Shader compilation
+ */
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+
+// Creates and links a program, or loads it from the program cache
+bool build_program(GLuint *program, const GLchar *vertex_source, const GLchar *fragment_source,
+                   const struct AttributeBinding *bindings, size_t binding_count)
+{
+    // Attribute bindings are baked into the binary, so they are part of the key
+    char binding_key[256] = "";
+    size_t binding_key_length = 0;
+    for (size_t i = 0; i < binding_count && binding_key_length < sizeof(binding_key); i++)
+    {
+        binding_key_length += snprintf(binding_key + binding_key_length, sizeof(binding_key) - binding_key_length,
+                                       "%u:%s;", bindings[i].index, bindings[i].name);
+    }
+
+    const GLchar *key_parts[] = {vertex_source, fragment_source, binding_key};
+    uint64_t key = get_program_cache_key(key_parts, 3);
+
+    if (load_cached_program(key, program))
+    {
+        return true;
+    }
+
+    GLuint _program;
+    if (!create_program(&_program, vertex_source, fragment_source))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < binding_count; i++)
+    {
+        glBindAttribLocation(_program, bindings[i].index, bindings[i].name);
+    }
+
+    if (!link_program(_program))
+    {
+        return false;
+    }
+
+    store_cached_program(key, _program);
+    (*program) = _program;
+
+    return true;
+}
+
+bool create_program(GLuint *program, const GLchar *vertex_source, const GLchar *fragment_source)
+{
+    // Load vertex shader
+    GLuint vertex_shader = load_shader(vertex_source, GL_VERTEX_SHADER);
+
+    if (!vertex_shader)
+    {
+        print_error("Failed to compile vertex shader\n");
+        return false;
+    }
+
+    // Load fragment shader
+    GLuint fragment_shader = load_shader(fragment_source, GL_FRAGMENT_SHADER);
+
+    if (!fragment_shader)
+    {
+        print_error("Failed to compile fragment shader\n");
+        delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+        return false;
+    }
+
+    GLuint _program = glCreateProgram();
+    if (!_program)
+    {
+        print_error("Failed to create program\n");
+        delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+        delete_gl_resource(GL_RESOURCE_SHADER, fragment_shader);
+        return false;
+    }
+
+    register_gl_resource(GL_RESOURCE_PROGRAM, _program);
+
+    glAttachShader(_program, vertex_shader);
+    glAttachShader(_program, fragment_shader);
+
+    // Attached shaders are only flagged for deletion and freed together with the program
+    delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+    delete_gl_resource(GL_RESOURCE_SHADER, fragment_shader);
+
+    (*program) = _program;
+
+    return true;
+}
+
+bool link_program(GLuint program)
+{
+    struct TraceSpan span = trace_begin("link program");
+    glLinkProgram(program);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    trace_end(&span);
+
+    if (!linked)
+    {
+        GLint info_length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_length);
+
+        if (info_length > 1)
+        {
+            char *info_log = malloc(sizeof(char) * info_length);
+            glGetProgramInfoLog(program, info_length, NULL, info_log);
+            print_error("Error linking program:\n%s\n", info_log);
+            free(info_log);
+        }
+
+        delete_gl_resource(GL_RESOURCE_PROGRAM, program);
+
+        return false;
+    }
+
+    return true;
+}
+
+GLuint load_shader(const GLchar *shader_source, GLenum type)
+{
+    GLuint shader = glCreateShader(type);
+
+    if (shader == 0)
+    {
+        print_error("Failed to create shader object\n");
+        return 0;
+    }
+
+    register_gl_resource(GL_RESOURCE_SHADER, shader);
+
+    struct TraceSpan span = trace_begin("compile shader");
+    glShaderSource(shader, 1, &shader_source, NULL);
+
+    glCompileShader(shader);
+
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    trace_end(&span);
+
+    if (!compiled)
+    {
+        print_error("Compilation of shader failed\n");
+
+        GLint info_length = 0;
+
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_length);
+
+        if (info_length > 1)
+        {
+            char *info_log = malloc(sizeof(char) * info_length);
+            glGetShaderInfoLog(shader, info_length, NULL, info_log);
+            print_error("Error compiling shader:\n%s\n", info_log);
+            free(info_log);
+        }
+
+        delete_gl_resource(GL_RESOURCE_SHADER, shader);
+
+        return 0;
+    }
+
+    return shader;
+}
+#endif
\ No newline at end of file
@@ -48,115 +48,33 @@ int64_t difftimespec_ns(const struct timespec after, const struct timespec befor
     return ((int64_t)after.tv_sec - (int64_t)before.tv_sec) * (int64_t)1000000000 + ((int64_t)after.tv_nsec - (int64_t)before.tv_nsec);
 }
 
-/*
- * Shader compilation
- */
-
-#ifdef NIGHTMARE_USE_GLES2
-#include <GLES2/gl2.h>
-
-bool create_program(GLuint *program, const GLchar *vertex_source, const GLchar *fragment_source)
+int64_t timespec_to_ns(const struct timespec time)
 {
-    // Load vertex shader
-    GLuint vertex_shader = load_shader(vertex_source, GL_VERTEX_SHADER);
-
-    if (!vertex_shader)
-    {
-        print_error("Failed to compile vertex shader\n");
-        return false;
-    }
-
-    // Load fragment shader
-    GLuint fragment_shader = load_shader(fragment_source, GL_FRAGMENT_SHADER);
-
-    if (!fragment_shader)
-    {
-        print_error("Failed to compile fragment shader\n");
-        return false;
-    }
-
-    GLuint _program = glCreateProgram();
-    if (!program)
-    {
-        print_error("Failed to create program\n");
-        return false;
-    }
-
-    glAttachShader(_program, vertex_shader);
-    glAttachShader(_program, fragment_shader);
-
-    (*program) = _program;
-
-    return true;
+    return (int64_t)time.tv_sec * (int64_t)1000000000 + (int64_t)time.tv_nsec;
 }
 
-bool link_program(GLuint program)
+// Resident set size of the process in KiB, includes driver allocations mapped into the process
+int64_t get_resident_memory_kib()
 {
-
-    glLinkProgram(program);
-
-    GLint linked;
-    glGetProgramiv(program, GL_LINK_STATUS, &linked);
-
-    if (!linked)
+    FILE *file = fopen("/proc/self/status", "r");
+    if (!file)
     {
-        GLint info_length = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_length);
-
-        if (info_length > 1)
-        {
-            char *info_log = malloc(sizeof(char) * info_length);
-            glGetProgramInfoLog(program, info_length, NULL, info_log);
-            print_error("Error linking program:\n%s\n", info_log);
-            free(info_log);
-        }
-
-        glDeleteProgram(program);
-
-        return false;
+        return -1;
     }
 
-    return true;
-}
-
-GLuint load_shader(const GLchar *shader_source, GLenum type)
-{
-    GLuint shader = glCreateShader(type);
-
-    if (shader == 0)
+    int64_t resident = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file))
     {
-        print_error("Failed to create shader object\n");
-        return 0;
-    }
-
-    glShaderSource(shader, 1, &shader_source, NULL);
-
-    glCompileShader(shader);
-
-    GLint compiled = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-
-    if (!compiled)
-    {
-        print_error("Compilation of shader failed\n");
-
-        GLint info_length = 0;
-
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_length);
-
-        if (info_length > 1)
+        long long value;
+        if (sscanf(line, "VmRSS: %lld kB", &value) == 1)
         {
-            char *info_log = malloc(sizeof(char) * info_length);
-            glGetShaderInfoLog(shader, info_length, NULL, info_log);
-            print_error("Error compiling shader:\n%s\n", info_log);
-            free(info_log);
+            resident = value;
+            break;
         }
-
-        glDeleteShader(shader);
-
-        return 0;
     }
 
-    return shader;
+    fclose(file);
+
+    return resident;
 }
-#endif
\ No newline at end of file
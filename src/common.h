@@ -4,14 +4,17 @@
 #pragma once
 
 #include <time.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 int print(const char *format, ...);
 int print_error(const char *format, ...);
 int64_t difftimespec_ns(const struct timespec after, const struct timespec before);
+int64_t timespec_to_ns(const struct timespec time);
 float from_fixed(int32_t value);
 int32_t to_fixed16(float value);
+int64_t get_resident_memory_kib();
 #define MS_IN_NS (uint64_t)1000000l
 #define SEC_IN_NS (uint64_t)1000000000l
 #define PI 3.14159265359
@@ -19,6 +22,14 @@ int32_t to_fixed16(float value);
 #ifdef NIGHTMARE_USE_GLES2
 #include <GLES2/gl2.h>
 
+struct AttributeBinding
+{
+    GLuint index;
+    const GLchar *name;
+};
+
+bool build_program(GLuint *program, const GLchar *vertex_source, const GLchar *fragment_source,
+                   const struct AttributeBinding *bindings, size_t binding_count);
 bool create_program(GLuint *program, const GLchar *vertex_source, const GLchar *fragment_source);
 bool link_program(GLuint program);
 GLuint load_shader(const GLchar *shader_source, GLenum type);
@@ -0,0 +1,261 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "results-file.h"
+#include "statistics.h"
+
+/*
+ * Results comparison
+ *
+ * Matches the scenes of a baseline and a candidate results file by name and
+ * parameters and compares their frame times with a Mann-Whitney U test. A
+ * change counts as a regression when it is significant and the median frame
+ * time grew by more than the threshold.
+ *
+ * Exit codes: 0 without regressions, 1 on regressions, 2 on errors.
+ */
+
+#define EXIT_REGRESSION 1
+#define EXIT_ERROR 2
+
+struct CompareOptions
+{
+    // Minimum change of the median frame time in percent
+    double threshold;
+    // Significance level of the rank test
+    double alpha;
+};
+
+static struct CompareOptions compare_options = {
+    .threshold = 5.0,
+    .alpha = 0.01,
+};
+
+static const struct option long_options[] = {
+    {"help", no_argument, NULL, 'h'},
+    {"threshold", required_argument, NULL, 't'},
+    {"alpha", required_argument, NULL, 'a'},
+    {NULL, 0, NULL, 0},
+};
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options] BASELINE CANDIDATE\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -h, --help            Show this help\n");
+    printf("  -t, --threshold PCT   Median frame time change counted as regression (default 5)\n");
+    printf("  -a, --alpha P         Significance level of the rank test (default 0.01)\n");
+}
+
+static bool parse_double(const char *text, double *value)
+{
+    char *end;
+    double result = strtod(text, &end);
+
+    if (*text == '\0' || *end != '\0')
+    {
+        return false;
+    }
+
+    (*value) = result;
+
+    return true;
+}
+
+static const struct ResultsFileScene *find_scene(const struct ResultsFile *results, const struct ResultsFileScene *scene,
+                                                 bool *matched)
+{
+    for (size_t i = 0; i < results->scene_count; i++)
+    {
+        const struct ResultsFileScene *candidate = &results->scenes[i];
+        if (!matched[i] && strcmp(candidate->name, scene->name) == 0 &&
+            strcmp(candidate->parameters, scene->parameters) == 0)
+        {
+            matched[i] = true;
+            return candidate;
+        }
+    }
+
+    return NULL;
+}
+
+static double get_change(double baseline, double candidate)
+{
+    return baseline != 0.0 ? (candidate - baseline) / baseline * 100.0 : 0.0;
+}
+
+// Scenes without a frame loop only have aggregated timings, which are reported but not tested
+static void compare_metrics(const struct ResultsFileScene *baseline, const struct ResultsFileScene *candidate)
+{
+    for (size_t i = 0; i < baseline->metric_count; i++)
+    {
+        const struct ResultsFileMetric *metric = &baseline->metrics[i];
+        size_t key_length = strlen(metric->key);
+        double value;
+
+        if (key_length < 3 || strcmp(metric->key + key_length - 3, "_ms") != 0 ||
+            !get_results_file_metric(candidate, metric->key, &value))
+        {
+            continue;
+        }
+
+        printf("  %-24s %10.3f -> %10.3f (%+6.1f%%), not tested\n",
+               metric->key, metric->value, value, get_change(metric->value, value));
+    }
+}
+
+// Returns true on a regression
+static bool compare_frames(const struct ResultsFileScene *baseline, const struct ResultsFileScene *candidate)
+{
+    double baseline_p50 = get_percentile(baseline->frame_ms, baseline->frame_count, 50.0);
+    double candidate_p50 = get_percentile(candidate->frame_ms, candidate->frame_count, 50.0);
+    double baseline_p99 = get_percentile(baseline->frame_ms, baseline->frame_count, 99.0);
+    double candidate_p99 = get_percentile(candidate->frame_ms, candidate->frame_count, 99.0);
+    double change = get_change(baseline_p50, candidate_p50);
+
+    struct RankTestResult test;
+    if (!mann_whitney_u_test(baseline->frame_ms, baseline->frame_count,
+                             candidate->frame_ms, candidate->frame_count, &test))
+    {
+        printf("  rank test failed\n");
+        return false;
+    }
+
+    bool significant = test.p_value < compare_options.alpha;
+    const char *verdict = "unchanged";
+    if (significant && change > compare_options.threshold)
+    {
+        verdict = "REGRESSION";
+    }
+    else if (significant && change < -compare_options.threshold)
+    {
+        verdict = "improvement";
+    }
+    else if (significant)
+    {
+        verdict = "within threshold";
+    }
+
+    printf("  frames    %10zu -> %10zu\n", baseline->frame_count, candidate->frame_count);
+    printf("  p50 ms    %10.3f -> %10.3f (%+6.1f%%)\n", baseline_p50, candidate_p50, change);
+    printf("  p99 ms    %10.3f -> %10.3f (%+6.1f%%)\n", baseline_p99, candidate_p99, get_change(baseline_p99, candidate_p99));
+    printf("  p-value %.3g, z %.2f, Cliff's delta %+.3f: %s\n", test.p_value, test.z, test.cliffs_delta, verdict);
+
+    return significant && change > compare_options.threshold;
+}
+
+int main(int argc, char *argv[])
+{
+    int option;
+    while ((option = getopt_long(argc, argv, "ht:a:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        case 't':
+            if (!parse_double(optarg, &compare_options.threshold) || compare_options.threshold < 0.0)
+            {
+                fprintf(stderr, "Invalid threshold '%s'\n", optarg);
+                return EXIT_ERROR;
+            }
+            break;
+        case 'a':
+            if (!parse_double(optarg, &compare_options.alpha) ||
+                compare_options.alpha <= 0.0 || compare_options.alpha >= 1.0)
+            {
+                fprintf(stderr, "Invalid significance level '%s'\n", optarg);
+                return EXIT_ERROR;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_ERROR;
+        }
+    }
+
+    if (argc - optind != 2)
+    {
+        print_usage(argv[0]);
+        return EXIT_ERROR;
+    }
+
+    struct ResultsFile baseline, candidate;
+    if (!read_results_file(argv[optind], &baseline))
+    {
+        return EXIT_ERROR;
+    }
+
+    if (!read_results_file(argv[optind + 1], &candidate))
+    {
+        free_results_file(&baseline);
+        return EXIT_ERROR;
+    }
+
+    bool *matched = calloc(candidate.scene_count + 1, sizeof(bool));
+    if (!matched)
+    {
+        free_results_file(&baseline);
+        free_results_file(&candidate);
+        return EXIT_ERROR;
+    }
+
+    size_t compared = 0;
+    size_t regressions = 0;
+    for (size_t i = 0; i < baseline.scene_count; i++)
+    {
+        const struct ResultsFileScene *scene = &baseline.scenes[i];
+        const struct ResultsFileScene *other = find_scene(&candidate, scene, matched);
+
+        printf("%s [%s]\n", scene->name, scene->parameters);
+        if (!other)
+        {
+            printf("  missing in candidate\n");
+            continue;
+        }
+
+        compared++;
+        if (scene->frame_count > 0 && other->frame_count > 0)
+        {
+            if (compare_frames(scene, other))
+            {
+                regressions++;
+            }
+        }
+        else
+        {
+            compare_metrics(scene, other);
+        }
+    }
+
+    for (size_t i = 0; i < candidate.scene_count; i++)
+    {
+        if (!matched[i])
+        {
+            printf("%s [%s]\n  missing in baseline\n", candidate.scenes[i].name, candidate.scenes[i].parameters);
+        }
+    }
+
+    printf("\n%zu scenes compared, %zu regressions (threshold %.1f%%, alpha %g)\n",
+           compared, regressions, compare_options.threshold, compare_options.alpha);
+
+    free(matched);
+    free_results_file(&baseline);
+    free_results_file(&candidate);
+
+    if (compared == 0)
+    {
+        fprintf(stderr, "No scenes could be matched\n");
+        return EXIT_ERROR;
+    }
+
+    return regressions > 0 ? EXIT_REGRESSION : 0;
+}
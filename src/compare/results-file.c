@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "results-file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "results-format.h"
+
+/*
+ * Results file reader
+ *
+ * Reads the records written by results_write() of the benchmark. Only the
+ * frame_ns column of the frames is kept, the performance counter columns are
+ * not compared.
+ */
+
+#define MAX_FIELDS 4
+
+// Splits the line in place at tabs, the last field keeps any further tabs
+static size_t split_fields(char *line, char **fields)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+
+    size_t count = 0;
+    fields[count++] = line;
+    while (count < MAX_FIELDS)
+    {
+        char *tab = strchr(fields[count - 1], '\t');
+        if (!tab)
+        {
+            break;
+        }
+
+        (*tab) = '\0';
+        fields[count++] = tab + 1;
+    }
+
+    return count;
+}
+
+static bool append_parameter(struct ResultsFileScene *scene, const char *key, const char *value)
+{
+    size_t length = strlen(scene->parameters);
+    size_t added = strlen(key) + strlen(value) + 2;
+
+    char *parameters = realloc(scene->parameters, length + added + 1);
+    if (!parameters)
+    {
+        return false;
+    }
+
+    snprintf(parameters + length, added + 1, "%s=%s;", key, value);
+    scene->parameters = parameters;
+
+    return true;
+}
+
+static bool append_frame(struct ResultsFileScene *scene, double frame_ms)
+{
+    if (scene->frame_count == scene->frame_capacity)
+    {
+        size_t capacity = scene->frame_capacity ? scene->frame_capacity * 2 : 1024;
+        double *frame_ms = realloc(scene->frame_ms, capacity * sizeof(double));
+        if (!frame_ms)
+        {
+            return false;
+        }
+
+        scene->frame_ms = frame_ms;
+        scene->frame_capacity = capacity;
+    }
+
+    scene->frame_ms[scene->frame_count++] = frame_ms;
+
+    return true;
+}
+
+static bool add_environment(struct ResultsFile *results, const char *key, const char *value)
+{
+    if (results->environment_count == results->environment_capacity)
+    {
+        size_t capacity = results->environment_capacity ? results->environment_capacity * 2 : 16;
+        struct ResultsFileEnvironment *environment = realloc(results->environment, capacity * sizeof(struct ResultsFileEnvironment));
+        if (!environment)
+        {
+            return false;
+        }
+
+        results->environment = environment;
+        results->environment_capacity = capacity;
+    }
+
+    struct ResultsFileEnvironment *entry = &results->environment[results->environment_count];
+    entry->key = strdup(key);
+    entry->value = strdup(value);
+    if (!entry->key || !entry->value)
+    {
+        free(entry->key);
+        free(entry->value);
+        return false;
+    }
+
+    results->environment_count++;
+
+    return true;
+}
+
+static bool add_startup_stage(struct ResultsFile *results, const char *name, double duration_ms, double finished_ms)
+{
+    if (results->startup_stage_count == results->startup_stage_capacity)
+    {
+        size_t capacity = results->startup_stage_capacity ? results->startup_stage_capacity * 2 : 16;
+        struct ResultsFileStartupStage *stages = realloc(results->startup_stages, capacity * sizeof(struct ResultsFileStartupStage));
+        if (!stages)
+        {
+            return false;
+        }
+
+        results->startup_stages = stages;
+        results->startup_stage_capacity = capacity;
+    }
+
+    struct ResultsFileStartupStage *stage = &results->startup_stages[results->startup_stage_count];
+    stage->name = strdup(name);
+    stage->duration_ms = duration_ms;
+    stage->finished_ms = finished_ms;
+    if (!stage->name)
+    {
+        return false;
+    }
+
+    results->startup_stage_count++;
+
+    return true;
+}
+
+static struct ResultsFileScene *add_scene(struct ResultsFile *results, const char *name)
+{
+    if (results->scene_count == results->scene_capacity)
+    {
+        size_t capacity = results->scene_capacity ? results->scene_capacity * 2 : 16;
+        struct ResultsFileScene *scenes = realloc(results->scenes, capacity * sizeof(struct ResultsFileScene));
+        if (!scenes)
+        {
+            return NULL;
+        }
+
+        results->scenes = scenes;
+        results->scene_capacity = capacity;
+    }
+
+    struct ResultsFileScene *scene = &results->scenes[results->scene_count];
+    memset(scene, 0, sizeof(*scene));
+    scene->name = strdup(name);
+    scene->parameters = strdup("");
+    if (!scene->name || !scene->parameters)
+    {
+        free(scene->name);
+        free(scene->parameters);
+        return NULL;
+    }
+
+    results->scene_count++;
+
+    return scene;
+}
+
+bool read_results_file(const char *path, struct ResultsFile *results)
+{
+    memset(results, 0, sizeof(*results));
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open results file '%s'\n", path);
+        return false;
+    }
+
+    bool success = false;
+    struct ResultsFileScene *scene = NULL;
+    size_t line_number = 0;
+    char line[4096];
+
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+
+        char *fields[MAX_FIELDS];
+        size_t count = split_fields(line, fields);
+        const char *record = fields[0];
+
+        if (line_number == 1)
+        {
+            if (strcmp(record, get_results_record_name(RESULTS_RECORD_HEADER)) != 0 || count < 2 ||
+                atoi(fields[1]) != RESULTS_FORMAT_VERSION)
+            {
+                fprintf(stderr, "%s: not a results file of format version %i\n", path, RESULTS_FORMAT_VERSION);
+                goto finish;
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_ENVIRONMENT)) == 0 && count >= 3)
+        {
+            if (!add_environment(results, fields[1], fields[2]))
+            {
+                fprintf(stderr, "Out of memory while reading '%s'\n", path);
+                goto finish;
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_STARTUP)) == 0 && count >= 4)
+        {
+            if (!add_startup_stage(results, fields[1], strtod(fields[2], NULL), strtod(fields[3], NULL)))
+            {
+                fprintf(stderr, "Out of memory while reading '%s'\n", path);
+                goto finish;
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_SCENE)) == 0 && count >= 2)
+        {
+            scene = add_scene(results, fields[1]);
+            if (!scene)
+            {
+                fprintf(stderr, "Out of memory while reading '%s'\n", path);
+                goto finish;
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_END)) == 0)
+        {
+            scene = NULL;
+        }
+        else if (!scene)
+        {
+            continue;
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_PARAMETER)) == 0 && count >= 3)
+        {
+            if (!append_parameter(scene, fields[1], fields[2]))
+            {
+                fprintf(stderr, "Out of memory while reading '%s'\n", path);
+                goto finish;
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_METRIC)) == 0 && count >= 3)
+        {
+            if (scene->metric_count < MAX_RESULTS_FILE_METRICS)
+            {
+                struct ResultsFileMetric *metric = &scene->metrics[scene->metric_count];
+                metric->key = strdup(fields[1]);
+                metric->value = strtod(fields[2], NULL);
+                if (metric->key)
+                {
+                    scene->metric_count++;
+                }
+            }
+        }
+        else if (strcmp(record, get_results_record_name(RESULTS_RECORD_FRAME)) == 0 && count >= 2)
+        {
+            if (!append_frame(scene, strtod(fields[1], NULL) / 1e6))
+            {
+                fprintf(stderr, "Out of memory while reading '%s'\n", path);
+                goto finish;
+            }
+        }
+    }
+
+    if (line_number == 0)
+    {
+        fprintf(stderr, "%s: empty results file\n", path);
+        goto finish;
+    }
+
+    success = true;
+
+finish:
+    fclose(file);
+
+    if (!success)
+    {
+        free_results_file(results);
+    }
+
+    return success;
+}
+
+void free_results_file(struct ResultsFile *results)
+{
+    for (size_t i = 0; i < results->scene_count; i++)
+    {
+        struct ResultsFileScene *scene = &results->scenes[i];
+        free(scene->name);
+        free(scene->parameters);
+        free(scene->frame_ms);
+        for (size_t m = 0; m < scene->metric_count; m++)
+        {
+            free(scene->metrics[m].key);
+        }
+    }
+
+    free(results->scenes);
+
+    for (size_t i = 0; i < results->environment_count; i++)
+    {
+        free(results->environment[i].key);
+        free(results->environment[i].value);
+    }
+    free(results->environment);
+
+    for (size_t i = 0; i < results->startup_stage_count; i++)
+    {
+        free(results->startup_stages[i].name);
+    }
+    free(results->startup_stages);
+
+    memset(results, 0, sizeof(*results));
+}
+
+bool get_results_file_metric(const struct ResultsFileScene *scene, const char *key, double *value)
+{
+    for (size_t i = 0; i < scene->metric_count; i++)
+    {
+        if (strcmp(scene->metrics[i].key, key) == 0)
+        {
+            (*value) = scene->metrics[i].value;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MAX_RESULTS_FILE_METRICS 32
+
+struct ResultsFileMetric
+{
+    char *key;
+    double value;
+};
+
+struct ResultsFileScene
+{
+    char *name;
+    // All parameters as "key=value;" pairs in file order, identifies the run
+    char *parameters;
+    struct ResultsFileMetric metrics[MAX_RESULTS_FILE_METRICS];
+    size_t metric_count;
+    // Frame durations in milliseconds
+    double *frame_ms;
+    size_t frame_count;
+    size_t frame_capacity;
+};
+
+struct ResultsFileEnvironment
+{
+    char *key;
+    char *value;
+};
+
+struct ResultsFileStartupStage
+{
+    char *name;
+    double duration_ms;
+    double finished_ms;
+};
+
+struct ResultsFile
+{
+    struct ResultsFileScene *scenes;
+    size_t scene_count;
+    size_t scene_capacity;
+    // Not compared, kept to be passed on by the harness
+    struct ResultsFileEnvironment *environment;
+    size_t environment_count;
+    size_t environment_capacity;
+    struct ResultsFileStartupStage *startup_stages;
+    size_t startup_stage_count;
+    size_t startup_stage_capacity;
+};
+
+bool read_results_file(const char *path, struct ResultsFile *results);
+void free_results_file(struct ResultsFile *results);
+bool get_results_file_metric(const struct ResultsFileScene *scene, const char *key, double *value);
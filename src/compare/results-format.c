@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "results-format.h"
+
+#include <stdarg.h>
+
+/*
+ * Results format
+ *
+ * The results file is line based, every line is a record whose fields are
+ * separated by tabs. The first field names the record:
+ *
+ *   nightmare-results  <format version>
+ *   environment        <key>  <value>
+ *   startup            <stage>  <duration ms>  <ms since process start>
+ *   scene              <name>
+ *   parameter          <key>  <value>     (identifies the run of a scene)
+ *   metric             <key>  <value>     (per scene)
+ *   frame-columns      <column>...
+ *   frame              <value>...         (one per frame, first column is frame_ns)
+ *   sensor-columns     <column>...
+ *   sensor             <value>...         (one per sensor sample, first column is time_ns)
+ *   end
+ *
+ * The benchmark, the harness which combines the files of its processes and
+ * the results file reader all use these records, so they cannot disagree on
+ * the format.
+ */
+
+static const char *record_names[RESULTS_RECORD_COUNT] = {
+    [RESULTS_RECORD_HEADER] = "nightmare-results",
+    [RESULTS_RECORD_ENVIRONMENT] = "environment",
+    [RESULTS_RECORD_STARTUP] = "startup",
+    [RESULTS_RECORD_SCENE] = "scene",
+    [RESULTS_RECORD_PARAMETER] = "parameter",
+    [RESULTS_RECORD_METRIC] = "metric",
+    [RESULTS_RECORD_FRAME_COLUMNS] = "frame-columns",
+    [RESULTS_RECORD_FRAME] = "frame",
+    [RESULTS_RECORD_SENSOR_COLUMNS] = "sensor-columns",
+    [RESULTS_RECORD_SENSOR] = "sensor",
+    [RESULTS_RECORD_END] = "end",
+};
+
+const char *get_results_record_name(enum ResultsRecord record)
+{
+    return record_names[record];
+}
+
+void begin_results_record(FILE *file, enum ResultsRecord record)
+{
+    fputs(record_names[record], file);
+}
+
+void add_results_field(FILE *file, const char *format, ...)
+{
+    fputc('\t', file);
+
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(file, format, arguments);
+    va_end(arguments);
+}
+
+void end_results_record(FILE *file)
+{
+    fputc('\n', file);
+}
+
+void write_results_header(FILE *file)
+{
+    begin_results_record(file, RESULTS_RECORD_HEADER);
+    add_results_field(file, "%i", RESULTS_FORMAT_VERSION);
+    end_results_record(file);
+}
+
+void write_environment_record(FILE *file, const char *key, const char *value)
+{
+    begin_results_record(file, RESULTS_RECORD_ENVIRONMENT);
+    add_results_field(file, "%s", key);
+    add_results_field(file, "%s", value);
+    end_results_record(file);
+}
+
+void write_startup_record(FILE *file, const char *stage, double duration_ms, double finished_ms)
+{
+    begin_results_record(file, RESULTS_RECORD_STARTUP);
+    add_results_field(file, "%s", stage);
+    add_results_field(file, "%f", duration_ms);
+    add_results_field(file, "%f", finished_ms);
+    end_results_record(file);
+}
+
+void write_scene_record(FILE *file, const char *name)
+{
+    begin_results_record(file, RESULTS_RECORD_SCENE);
+    add_results_field(file, "%s", name);
+    end_results_record(file);
+}
+
+// Parameters and metrics keep the format of their value, counts are written without decimals
+static void write_value_record(FILE *file, enum ResultsRecord record, const char *key, const char *format, va_list arguments)
+{
+    begin_results_record(file, record);
+    add_results_field(file, "%s", key);
+    fputc('\t', file);
+    vfprintf(file, format, arguments);
+    end_results_record(file);
+}
+
+void write_parameter_record(FILE *file, const char *key, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    write_value_record(file, RESULTS_RECORD_PARAMETER, key, format, arguments);
+    va_end(arguments);
+}
+
+void write_metric_record(FILE *file, const char *key, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    write_value_record(file, RESULTS_RECORD_METRIC, key, format, arguments);
+    va_end(arguments);
+}
+
+void write_end_record(FILE *file)
+{
+    begin_results_record(file, RESULTS_RECORD_END);
+    end_results_record(file);
+}
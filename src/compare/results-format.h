@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdio.h>
+
+// Written in the first record, files of other versions are not read
+#define RESULTS_FORMAT_VERSION 1
+
+enum ResultsRecord
+{
+    RESULTS_RECORD_HEADER,
+    RESULTS_RECORD_ENVIRONMENT,
+    RESULTS_RECORD_STARTUP,
+    RESULTS_RECORD_SCENE,
+    RESULTS_RECORD_PARAMETER,
+    RESULTS_RECORD_METRIC,
+    RESULTS_RECORD_FRAME_COLUMNS,
+    RESULTS_RECORD_FRAME,
+    RESULTS_RECORD_SENSOR_COLUMNS,
+    RESULTS_RECORD_SENSOR,
+    RESULTS_RECORD_END,
+    RESULTS_RECORD_COUNT,
+};
+
+const char *get_results_record_name(enum ResultsRecord record);
+
+// Writes a record field by field, every field is preceded by a tab
+void begin_results_record(FILE *file, enum ResultsRecord record);
+void add_results_field(FILE *file, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void end_results_record(FILE *file);
+
+void write_results_header(FILE *file);
+void write_environment_record(FILE *file, const char *key, const char *value);
+void write_startup_record(FILE *file, const char *stage, double duration_ms, double finished_ms);
+void write_scene_record(FILE *file, const char *name);
+void write_parameter_record(FILE *file, const char *key, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void write_metric_record(FILE *file, const char *key, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void write_end_record(FILE *file);
@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "statistics.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Statistics
+ *
+ * Frame times are skewed and have long tails, so the samples are compared
+ * with a rank test instead of a t-test on the means.
+ */
+
+struct RankedValue
+{
+    double value;
+    // 0 for the first sample, 1 for the second
+    int sample;
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double value_a = *(const double *)a;
+    double value_b = *(const double *)b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static int compare_ranked_values(const void *a, const void *b)
+{
+    return compare_doubles(&((const struct RankedValue *)a)->value, &((const struct RankedValue *)b)->value);
+}
+
+// Linearly interpolated percentile in [0, 100], NAN for an empty sample
+double get_percentile(const double *values, size_t count, double percentile)
+{
+    if (count == 0)
+    {
+        return NAN;
+    }
+
+    double *sorted = malloc(count * sizeof(double));
+    if (!sorted)
+    {
+        return NAN;
+    }
+
+    memcpy(sorted, values, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double position = percentile / 100.0 * (count - 1);
+    size_t lower = (size_t)position;
+    size_t upper = lower + 1 < count ? lower + 1 : lower;
+    double fraction = position - lower;
+    double result = sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+
+    free(sorted);
+
+    return result;
+}
+
+bool mann_whitney_u_test(const double *a, size_t a_count, const double *b, size_t b_count,
+                         struct RankTestResult *result)
+{
+    if (a_count == 0 || b_count == 0)
+    {
+        return false;
+    }
+
+    size_t count = a_count + b_count;
+    struct RankedValue *values = malloc(count * sizeof(struct RankedValue));
+    if (!values)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a_count; i++)
+    {
+        values[i].value = a[i];
+        values[i].sample = 0;
+    }
+    for (size_t i = 0; i < b_count; i++)
+    {
+        values[a_count + i].value = b[i];
+        values[a_count + i].sample = 1;
+    }
+
+    qsort(values, count, sizeof(struct RankedValue), compare_ranked_values);
+
+    // Tied values share the average of their ranks
+    double b_rank_sum = 0.0;
+    double tie_correction = 0.0;
+    for (size_t start = 0; start < count;)
+    {
+        size_t end = start + 1;
+        while (end < count && values[end].value == values[start].value)
+        {
+            end++;
+        }
+
+        double ties = end - start;
+        double rank = (start + 1 + end) / 2.0;
+        for (size_t i = start; i < end; i++)
+        {
+            if (values[i].sample == 1)
+            {
+                b_rank_sum += rank;
+            }
+        }
+
+        tie_correction += ties * ties * ties - ties;
+        start = end;
+    }
+
+    free(values);
+
+    double n_a = a_count;
+    double n_b = b_count;
+    double n = count;
+    double u = b_rank_sum - n_b * (n_b + 1.0) / 2.0;
+    double mean = n_a * n_b / 2.0;
+    double variance = n_a * n_b / 12.0 * ((n + 1.0) - tie_correction / (n * (n - 1.0)));
+
+    result->u = u;
+    result->z = variance > 0.0 ? (u - mean) / sqrt(variance) : 0.0;
+    result->p_value = erfc(fabs(result->z) / sqrt(2.0));
+    result->cliffs_delta = 2.0 * u / (n_a * n_b) - 1.0;
+
+    return true;
+}
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct RankTestResult
+{
+    // Mann-Whitney U statistic of the second sample
+    double u;
+    double z;
+    // Two-sided, from the normal approximation
+    double p_value;
+    // Probability that a value of the second sample is larger minus the
+    // probability that it is smaller, in [-1, 1]
+    double cliffs_delta;
+};
+
+double get_percentile(const double *values, size_t count, double percentile);
+bool mann_whitney_u_test(const double *a, size_t a_count, const double *b, size_t b_count,
+                         struct RankTestResult *result);
@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "damage.h"
+
+#include <math.h>
+#include "egl.h"
+
+/*
+ * Damage tracking for partial redraws
+ *
+ * Scenes report what their update() changed for the current frame. The
+ * damage of the last frames is kept, so the region which has to be repainted
+ * can be computed for a back buffer of any age (EGL_EXT_buffer_age).
+ */
+
+#define DAMAGE_HISTORY_LENGTH 8
+
+static struct DamageRect current;
+static struct DamageRect history[DAMAGE_HISTORY_LENGTH];
+static int history_start = 0;
+static int history_count = 0;
+
+static inline bool is_empty(struct DamageRect rect)
+{
+    return rect.width <= 0 || rect.height <= 0;
+}
+
+static struct DamageRect unite(struct DamageRect a, struct DamageRect b)
+{
+    if (is_empty(a))
+    {
+        return b;
+    }
+    else if (is_empty(b))
+    {
+        return a;
+    }
+
+    int x0 = a.x < b.x ? a.x : b.x;
+    int y0 = a.y < b.y ? a.y : b.y;
+    int x1 = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+    int y1 = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+
+    struct DamageRect result = {x0, y0, x1 - x0, y1 - y0};
+    return result;
+}
+
+static struct DamageRect clip_to_screen(struct DamageRect rect)
+{
+    int x0 = rect.x < 0 ? 0 : rect.x;
+    int y0 = rect.y < 0 ? 0 : rect.y;
+    int x1 = rect.x + rect.width > screen_width ? screen_width : rect.x + rect.width;
+    int y1 = rect.y + rect.height > screen_height ? screen_height : rect.y + rect.height;
+
+    struct DamageRect result = {x0, y0, x1 - x0, y1 - y0};
+    if (is_empty(result))
+    {
+        result.width = 0;
+        result.height = 0;
+    }
+
+    return result;
+}
+
+void damage_reset()
+{
+    history_start = 0;
+    history_count = 0;
+
+    // Nothing has been drawn yet
+    damage_add_full();
+}
+
+void damage_add_full()
+{
+    struct DamageRect full = {0, 0, screen_width, screen_height};
+    current = full;
+}
+
+void damage_add_rect(int x, int y, int width, int height)
+{
+    struct DamageRect rect = {x, y, width, height};
+    current = clip_to_screen(unite(current, rect));
+}
+
+void damage_add_ndc_rect(float x0, float y0, float x1, float y1, int margin)
+{
+    // Convert normalized device coordinates to window coordinates
+    float px0 = (fminf(x0, x1) + 1.0f) * 0.5f * screen_width;
+    float px1 = (fmaxf(x0, x1) + 1.0f) * 0.5f * screen_width;
+    float py0 = (fminf(y0, y1) + 1.0f) * 0.5f * screen_height;
+    float py1 = (fmaxf(y0, y1) + 1.0f) * 0.5f * screen_height;
+
+    int x = (int)floorf(px0) - margin;
+    int y = (int)floorf(py0) - margin;
+    int width = (int)ceilf(px1) + margin - x;
+    int height = (int)ceilf(py1) + margin - y;
+
+    damage_add_rect(x, y, width, height);
+}
+
+bool damage_is_empty()
+{
+    return is_empty(current);
+}
+
+struct DamageRect damage_get_current()
+{
+    return current;
+}
+
+bool damage_get_repaint_region(int buffer_age, struct DamageRect *region)
+{
+    // Age 0 means the content of the back buffer is undefined
+    if (buffer_age <= 0 || buffer_age - 1 > history_count)
+    {
+        return false;
+    }
+
+    struct DamageRect result = current;
+    for (int i = 0; i < buffer_age - 1; i++)
+    {
+        int index = (history_start + history_count - 1 - i) % DAMAGE_HISTORY_LENGTH;
+        result = unite(result, history[index]);
+    }
+
+    (*region) = result;
+
+    return true;
+}
+
+void damage_finish_frame()
+{
+    if (history_count < DAMAGE_HISTORY_LENGTH)
+    {
+        history[(history_start + history_count) % DAMAGE_HISTORY_LENGTH] = current;
+        history_count++;
+    }
+    else
+    {
+        history[history_start] = current;
+        history_start = (history_start + 1) % DAMAGE_HISTORY_LENGTH;
+    }
+
+    current.width = 0;
+    current.height = 0;
+}
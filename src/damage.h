@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+
+// Rectangle in window coordinates (origin bottom left, like glScissor and EGL damage rects)
+struct DamageRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+void damage_reset();
+void damage_add_full();
+void damage_add_rect(int x, int y, int width, int height);
+void damage_add_ndc_rect(float x0, float y0, float x1, float y1, int margin);
+bool damage_is_empty();
+struct DamageRect damage_get_current();
+bool damage_get_repaint_region(int buffer_age, struct DamageRect *region);
+void damage_finish_frame();
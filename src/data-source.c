@@ -0,0 +1,274 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "data-source.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "random.h"
+#include "shm-ring.h"
+
+/*
+ * Data source
+ *
+ * The graph scenes take their samples from here. Without a series file the
+ * samples come from the random table. A series file is mapped into memory
+ * and read in place, so recordings of any length replay without being
+ * loaded. Lines beyond the number of channels reuse the channels.
+ *
+ * When ingesting, another process publishes the samples through a shared
+ * memory ring and every sample is added as soon as a frame sees it. Samples
+ * which arrived in a burst are all added in the same frame, unless there are
+ * more than the scene shows at once.
+ */
+
+static const struct SeriesHeader *header = NULL;
+static size_t mapping_size = 0;
+static const float *samples = NULL;
+static uint64_t position = 0;
+static float offset = 0.0f;
+static float factor = 1.0f;
+
+// Arrivals in the ring cannot be waited for, they are polled instead
+#define INGEST_POLL_INTERVAL_NS (1 * MS_IN_NS)
+
+static struct ShmRing ring = {0};
+static struct IngestStatistics ingest_statistics;
+static uint32_t dropped_at_reset = 0;
+// Time at which the current frame took its samples
+static int64_t ingest_time_ns = 0;
+
+_Static_assert(sizeof(struct SeriesHeader) == 64, "series header has to be 64 bytes");
+
+bool initialize_data_source(const char *path)
+{
+    if (!path)
+    {
+        return true;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        print_error("Could not open series file '%s'\n", path);
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(struct SeriesHeader))
+    {
+        print_error("Series file '%s' is too small\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        print_error("Could not map series file '%s'\n", path);
+        return false;
+    }
+
+    mapping_size = status.st_size;
+    header = mapping;
+
+    if (memcmp(header->magic, SERIES_MAGIC, sizeof(header->magic)) != 0 || header->version != SERIES_VERSION)
+    {
+        print_error("'%s' is not a version %i series file\n", path, SERIES_VERSION);
+        cleanup_data_source();
+        return false;
+    }
+
+    // Divided instead of multiplied, so crafted counts cannot wrap around the bounds check
+    if (header->channel_count == 0 || header->sample_count == 0 || header->data_offset % sizeof(float) != 0 ||
+        header->data_offset < sizeof(struct SeriesHeader) || header->data_offset > mapping_size ||
+        header->sample_count > (mapping_size - header->data_offset) / sizeof(float) / header->channel_count)
+    {
+        print_error("Series file '%s' is truncated or has an invalid layout\n", path);
+        cleanup_data_source();
+        return false;
+    }
+
+    samples = (const float *)((const uint8_t *)mapping + header->data_offset);
+    offset = header->minimum;
+    factor = header->maximum > header->minimum ? 1.0f / (header->maximum - header->minimum) : 1.0f;
+
+    // Page faults during the run would show up as frame time
+    madvise(mapping, mapping_size, MADV_WILLNEED);
+
+    print("Replaying %u channels x %llu samples from '%s'\n\n", header->channel_count, (unsigned long long)header->sample_count, path);
+
+    return true;
+}
+
+bool initialize_data_ingestion(const char *name)
+{
+    if (!shm_ring_open(&ring, name))
+    {
+        print_error("Could not open shared memory ring '%s', is the producer running?\n", name);
+        return false;
+    }
+
+    const struct ShmRingHeader *ring_header = ring.header;
+    offset = ring_header->minimum;
+    factor = ring_header->maximum > ring_header->minimum ? 1.0f / (ring_header->maximum - ring_header->minimum) : 1.0f;
+
+    print("Ingesting %u channels from shared memory ring '%s' (%u samples)\n\n",
+          ring_header->channel_count, name, ring_header->capacity);
+
+    return true;
+}
+
+void cleanup_data_source()
+{
+    if (header)
+    {
+        munmap((void *)header, mapping_size);
+    }
+    shm_ring_close(&ring);
+
+    header = NULL;
+    samples = NULL;
+    mapping_size = 0;
+}
+
+void reset_data_source()
+{
+    position = 0;
+    reset_random();
+
+    if (ring.header)
+    {
+        // Whatever queued up in between belongs to no scene
+        shm_ring_consume(&ring, shm_ring_available(&ring));
+        dropped_at_reset = atomic_load_explicit(&ring.header->dropped, memory_order_relaxed);
+        memset(&ingest_statistics, 0, sizeof(ingest_statistics));
+    }
+}
+
+static int64_t get_interval_ns(int64_t default_ns)
+{
+    return header && header->sample_interval_ns > 0 ? header->sample_interval_ns : default_ns;
+}
+
+size_t get_data_steps(int64_t *timer, int64_t interval_ns, size_t max_steps)
+{
+    if (!ring.header)
+    {
+        if (*timer > 0)
+        {
+            return 0;
+        }
+
+        (*timer) += get_interval_ns(interval_ns);
+        return 1;
+    }
+
+    (*timer) = 0;
+
+    uint32_t available = shm_ring_available(&ring);
+    if (available == 0)
+    {
+        return 0;
+    }
+
+    if (available > ingest_statistics.max_batch)
+    {
+        ingest_statistics.max_batch = available;
+    }
+
+    // Older samples would scroll out within the same frame
+    if (available > max_steps)
+    {
+        shm_ring_consume(&ring, available - max_steps);
+        ingest_statistics.skipped += available - max_steps;
+        available = max_steps;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ingest_time_ns = (int64_t)now.tv_sec * SEC_IN_NS + now.tv_nsec;
+
+    return available;
+}
+
+int64_t get_data_next_change(int64_t timer)
+{
+    if (ring.header)
+    {
+        return shm_ring_available(&ring) > 0 ? 0 : INGEST_POLL_INTERVAL_NS;
+    }
+
+    return timer > 0 ? timer : 0;
+}
+
+float get_data_sample(size_t line)
+{
+    if (ring.header)
+    {
+        const struct ShmRingRecord *record = shm_ring_peek(&ring, 0);
+        float value = (record->values[line % ring.header->channel_count] - offset) * factor;
+
+        return value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+    }
+
+    if (!samples)
+    {
+        return get_random_float();
+    }
+
+    float value = (samples[(line % header->channel_count) * header->sample_count + position] - offset) * factor;
+
+    return value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+}
+
+int32_t get_data_sample_fixed16(size_t line)
+{
+    if (!samples && !ring.header)
+    {
+        return get_random_fixed16();
+    }
+
+    return to_fixed16(get_data_sample(line));
+}
+
+void advance_data_source()
+{
+    if (ring.header)
+    {
+        int64_t latency_ns = ingest_time_ns - shm_ring_peek(&ring, 0)->time_ns;
+        ingest_statistics.received++;
+        ingest_statistics.total_latency_ns += latency_ns;
+        if (latency_ns > ingest_statistics.max_latency_ns)
+        {
+            ingest_statistics.max_latency_ns = latency_ns;
+        }
+
+        shm_ring_consume(&ring, 1);
+        return;
+    }
+
+    if (samples && ++position >= header->sample_count)
+    {
+        position = 0;
+    }
+}
+
+bool get_ingest_statistics(struct IngestStatistics *statistics)
+{
+    if (!ring.header)
+    {
+        return false;
+    }
+
+    (*statistics) = ingest_statistics;
+    statistics->dropped = (uint32_t)(atomic_load_explicit(&ring.header->dropped, memory_order_relaxed) - dropped_at_reset);
+
+    return true;
+}
@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SERIES_MAGIC "NMSERIES"
+#define SERIES_VERSION 1
+
+// Header of a series file, followed by channel_count arrays of sample_count
+// little endian floats (one array per channel) starting at data_offset
+struct SeriesHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channel_count;
+    uint64_t sample_count;
+    uint64_t data_offset;
+    // Values are mapped from [minimum, maximum] to [0, 1]
+    float minimum;
+    float maximum;
+    // Time between two samples (0 keeps the interval of the scene)
+    int64_t sample_interval_ns;
+    uint8_t reserved[16];
+};
+
+// Samples taken from a shared memory ring since the last reset
+struct IngestStatistics
+{
+    // Samples added to the scene
+    uint64_t received;
+    // Samples passed over because more arrived within a frame than the scene shows
+    uint64_t skipped;
+    // Samples the producer discarded because the ring was full
+    uint64_t dropped;
+    // Most samples which arrived within one frame
+    uint64_t max_batch;
+    // Time from publishing a sample to adding it to the scene
+    int64_t total_latency_ns;
+    int64_t max_latency_ns;
+};
+
+// Replays the series file at path, or the random table if path is NULL
+bool initialize_data_source(const char *path);
+// Takes the samples from the shared memory ring name written by another process
+bool initialize_data_ingestion(const char *name);
+void cleanup_data_source();
+// Rewinds to the first sample, or skips every sample which already arrived
+void reset_data_source();
+
+// Number of samples to add this frame. Timed sources add one sample whenever
+// the interval (or the recorded interval) passed on the timer, ingested
+// samples are added as they arrive but at most max_steps of them.
+size_t get_data_steps(int64_t *timer, int64_t interval_ns, size_t max_steps);
+
+// Sample of the line at the current time in [0, 1]
+float get_data_sample(size_t line);
+int32_t get_data_sample_fixed16(size_t line);
+// Time until get_data_steps() has samples again for the given timer
+int64_t get_data_next_change(int64_t timer);
+// Moves on to the next sample of every line
+void advance_data_source();
+
+// False unless samples are ingested
+bool get_ingest_statistics(struct IngestStatistics *statistics);
@@ -0,0 +1,307 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "decimation.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "common.h"
+#include "options.h"
+
+/*
+ * Decimation
+ *
+ * Lines with more samples than pixel columns are reduced before they are
+ * handed to GL, so the vertex work is bound by the width of the screen
+ * instead of the number of samples. The samples are grouped into buckets of
+ * consecutive samples no wider than a pixel column. Buckets are aligned to
+ * the absolute sample index, so they stay the same while the graph scrolls.
+ *
+ * Min/max keeps the smallest and largest sample of every bucket in the order
+ * they arrived, which draws the same vertical extent per column as all of
+ * the samples. The extremes of a bucket are updated as each sample arrives,
+ * only the oldest bucket, which has partly scrolled out, is summarised
+ * again from the samples on every draw.
+ *
+ * Largest triangle three buckets keeps the one sample per bucket which forms
+ * the largest triangle with the sample kept of the previous bucket and the
+ * average of the next bucket. It depends on the previous choice and is
+ * therefore computed from every sample on each draw.
+ *
+ * Both work on floats, for the fixed point graph the kept points are
+ * converted back to fixed point afterwards, so its lines stay GL_FIXED.
+ */
+
+struct Bucket
+{
+    float minimum;
+    float maximum;
+    // Absolute index of the samples
+    uint64_t minimum_index;
+    uint64_t maximum_index;
+};
+
+static size_t line_count = 0;
+static size_t point_count = 0;
+// Samples per bucket
+static size_t bucket_size = 0;
+static size_t bucket_capacity = 0;
+// Ring of the latest point_count samples per line
+static float *samples = NULL;
+// Ring of bucket_capacity buckets per line
+static struct Bucket *buckets = NULL;
+static float *output = NULL;
+// Output converted to fixed point, only allocated for fixed output
+static int32_t *fixed_output = NULL;
+static size_t output_capacity = 0;
+// Samples added to every line since the initialization
+static uint64_t sample_total = 0;
+static bool active = false;
+static bool bypassed = false;
+
+bool initialize_decimation(size_t lines, size_t points, size_t columns, bool fixed)
+{
+    line_count = lines;
+    point_count = points;
+    sample_total = 0;
+    bypassed = false;
+
+    // Fewer samples per column than a bucket keeps would not reduce anything
+    bucket_size = columns > 0 ? point_count / columns : 0;
+    active = (options.decimation == DECIMATION_MIN_MAX && bucket_size >= 3) ||
+             (options.decimation == DECIMATION_LTTB && bucket_size >= 2);
+    if (!active)
+    {
+        return true;
+    }
+
+    // The window of point_count samples overlaps at most one partial bucket at either end
+    bucket_capacity = point_count / bucket_size + 2;
+    output_capacity = options.decimation == DECIMATION_MIN_MAX ? 2 * bucket_capacity : bucket_capacity;
+
+    samples = malloc(line_count * point_count * sizeof(float));
+    buckets = malloc(line_count * bucket_capacity * sizeof(struct Bucket));
+    output = malloc(2 * line_count * output_capacity * sizeof(float));
+    fixed_output = fixed ? malloc(2 * line_count * output_capacity * sizeof(int32_t)) : NULL;
+    if (!samples || !buckets || !output || (fixed && !fixed_output))
+    {
+        print_error("Failed to allocate memory for decimation\n");
+        cleanup_decimation();
+        return false;
+    }
+
+    return true;
+}
+
+void cleanup_decimation()
+{
+    free(samples);
+    free(buckets);
+    free(output);
+    free(fixed_output);
+    samples = NULL;
+    buckets = NULL;
+    output = NULL;
+    fixed_output = NULL;
+    active = false;
+}
+
+bool is_decimation_active()
+{
+    return active && !bypassed;
+}
+
+void set_decimation_bypass(bool bypass)
+{
+    bypassed = bypass;
+}
+
+size_t get_decimated_capacity()
+{
+    return active ? output_capacity : 0;
+}
+
+static inline float get_sample(size_t line, uint64_t index)
+{
+    return samples[line * point_count + index % point_count];
+}
+
+static inline struct Bucket *get_bucket(size_t line, uint64_t bucket)
+{
+    return &buckets[line * bucket_capacity + bucket % bucket_capacity];
+}
+
+void add_decimation_sample(size_t line, float y)
+{
+    if (!active)
+    {
+        return;
+    }
+
+    samples[line * point_count + sample_total % point_count] = y;
+
+    struct Bucket *bucket = get_bucket(line, sample_total / bucket_size);
+    if (sample_total % bucket_size == 0)
+    {
+        (*bucket) = (struct Bucket){y, y, sample_total, sample_total};
+    }
+    else if (y < bucket->minimum)
+    {
+        bucket->minimum = y;
+        bucket->minimum_index = sample_total;
+    }
+    else if (y > bucket->maximum)
+    {
+        bucket->maximum = y;
+        bucket->maximum_index = sample_total;
+    }
+}
+
+void advance_decimation()
+{
+    if (active)
+    {
+        sample_total++;
+    }
+}
+
+// Extremes of the samples [first, end) of a line
+static struct Bucket summarize(size_t line, uint64_t first, uint64_t end)
+{
+    float y = get_sample(line, first);
+    struct Bucket bucket = {y, y, first, first};
+    for (uint64_t index = first + 1; index < end; index++)
+    {
+        y = get_sample(line, index);
+        if (y < bucket.minimum)
+        {
+            bucket.minimum = y;
+            bucket.minimum_index = index;
+        }
+        else if (y > bucket.maximum)
+        {
+            bucket.maximum = y;
+            bucket.maximum_index = index;
+        }
+    }
+
+    return bucket;
+}
+
+static size_t decimate_min_max(size_t line, uint64_t first, float *points, float x_step)
+{
+    uint64_t first_bucket = first / bucket_size;
+    uint64_t last_bucket = (sample_total - 1) / bucket_size;
+    size_t count = 0;
+
+    for (uint64_t b = first_bucket; b <= last_bucket; b++)
+    {
+        struct Bucket bucket = b == first_bucket && first % bucket_size != 0
+                                   ? summarize(line, first, (b + 1) * bucket_size < sample_total ? (b + 1) * bucket_size : sample_total)
+                                   : *get_bucket(line, b);
+
+        // Both extremes in the order they arrived, a single sample is kept twice so every line has the same count
+        bool minimum_first = bucket.minimum_index <= bucket.maximum_index;
+        uint64_t indices[2] = {minimum_first ? bucket.minimum_index : bucket.maximum_index,
+                               minimum_first ? bucket.maximum_index : bucket.minimum_index};
+        float values[2] = {minimum_first ? bucket.minimum : bucket.maximum,
+                           minimum_first ? bucket.maximum : bucket.minimum};
+        for (int i = 0; i < 2; i++)
+        {
+            points[count * 2] = (indices[i] - first) * x_step - 1.0f;
+            points[count * 2 + 1] = values[i];
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static size_t decimate_lttb(size_t line, uint64_t first, float *points, float x_step)
+{
+    uint64_t first_bucket = first / bucket_size;
+    uint64_t last_bucket = (sample_total - 1) / bucket_size;
+    size_t count = 0;
+
+    // The first and the last sample are always kept
+    uint64_t selected = first;
+    points[count * 2] = -1.0f;
+    points[count * 2 + 1] = get_sample(line, first);
+    count++;
+
+    for (uint64_t b = first_bucket + 1; b < last_bucket; b++)
+    {
+        uint64_t next_first = (b + 1) * bucket_size;
+        uint64_t next_end = next_first + bucket_size < sample_total ? next_first + bucket_size : sample_total;
+        float average_x = 0.0f;
+        float average_y = 0.0f;
+        for (uint64_t index = next_first; index < next_end; index++)
+        {
+            average_x += index - first;
+            average_y += get_sample(line, index);
+        }
+        average_x /= next_end - next_first;
+        average_y /= next_end - next_first;
+
+        float selected_x = selected - first;
+        float selected_y = get_sample(line, selected);
+        float largest_area = -1.0f;
+        for (uint64_t index = b * bucket_size; index < next_first; index++)
+        {
+            float x = index - first;
+            float y = get_sample(line, index);
+            float area = fabsf((selected_x - average_x) * (y - selected_y) - (selected_x - x) * (average_y - selected_y));
+            if (area > largest_area)
+            {
+                largest_area = area;
+                selected = index;
+            }
+        }
+
+        points[count * 2] = (selected - first) * x_step - 1.0f;
+        points[count * 2 + 1] = get_sample(line, selected);
+        count++;
+    }
+
+    if (last_bucket > first_bucket)
+    {
+        points[count * 2] = (sample_total - 1 - first) * x_step - 1.0f;
+        points[count * 2 + 1] = get_sample(line, sample_total - 1);
+        count++;
+    }
+
+    return count;
+}
+
+const void *decimate_lines(size_t *count)
+{
+    (*count) = 0;
+    if (sample_total == 0)
+    {
+        return fixed_output ? (const void *)fixed_output : output;
+    }
+
+    // Samples are placed like the undecimated ones, the oldest one of the window at the left edge
+    uint64_t window = sample_total < point_count ? sample_total : point_count;
+    uint64_t first = sample_total - window;
+    float x_step = 2.0f / (float)(point_count - 1);
+
+    for (size_t line = 0; line < line_count; line++)
+    {
+        float *points = output + line * output_capacity * 2;
+        (*count) = options.decimation == DECIMATION_MIN_MAX ? decimate_min_max(line, first, points, x_step)
+                                                            : decimate_lttb(line, first, points, x_step);
+
+        if (fixed_output)
+        {
+            int32_t *fixed_points = fixed_output + line * output_capacity * 2;
+            for (size_t i = 0; i < (*count) * 2; i++)
+            {
+                fixed_points[i] = to_fixed16(points[i]);
+            }
+        }
+    }
+
+    return fixed_output ? (const void *)fixed_output : output;
+}
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Reduces line_count lines of the latest point_count samples, which span
+// columns pixel columns, with the decimation of the options. The points are
+// returned as 16.16 fixed point values (GL_FIXED) if fixed_output is set and
+// as floats (GL_FLOAT) otherwise.
+bool initialize_decimation(size_t line_count, size_t point_count, size_t columns, bool fixed_output);
+void cleanup_decimation();
+
+// Whether the lines are drawn decimated, false if they do not have enough
+// samples per pixel column to be reduced
+bool is_decimation_active();
+// Lines are drawn from every sample while bypassed, to compare the output
+void set_decimation_bypass(bool bypass);
+// Most points per line decimate_lines() returns
+size_t get_decimated_capacity();
+
+// Adds the next sample of a line, advance_decimation() moves on once every line got its sample
+void add_decimation_sample(size_t line, float y);
+void advance_decimation();
+
+// Consecutive x/y pairs of every line, get_decimated_capacity() points
+// apart, with x in [-1, 1] like the samples of the graph scenes. count is
+// set to the points per line.
+const void *decimate_lines(size_t *count);
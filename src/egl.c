@@ -11,24 +11,93 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include "common.h"
+#include "options.h"
+#include "startup.h"
+#include "event-loop.h"
+#include "signal-handler.h"
 
 /**
  * EGL/X11
  */
 
 Display *x11_display = NULL;
-Window x11_window;
 
 int egl_major = -1;
 int egl_minor = -1;
 EGLDisplay egl_display;
-EGLSurface egl_surface;
+EGLSurface egl_surface = EGL_NO_SURFACE;
 
 int screen_width = 0;
 int screen_height = 0;
 
-bool initialize_egl()
+int render_width = 0;
+int render_height = 0;
+
+static PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swap_buffers_with_damage = NULL;
+static PFNEGLSETDAMAGEREGIONKHRPROC set_damage_region = NULL;
+
+EGLint egl_renderable_type = 0;
+
+// One context per GLES major version, all render to the same surface
+static EGLContext egl_contexts[3] = {EGL_NO_CONTEXT, EGL_NO_CONTEXT, EGL_NO_CONTEXT};
+static EGLint context_version = 0;
+static EGLConfig surface_config;
+static Colormap x11_colormap;
+// Every surface shows the scenes, egl_surface is the current one
+static EGLSurface egl_surfaces[MAX_SURFACES];
+static Window x11_windows[MAX_SURFACES];
+static size_t surface_count = 0;
+static size_t window_count = 0;
+static Atom wm_delete = None;
+// Rendering to a pbuffer on the surfaceless platform, without X11
+static bool offscreen = false;
+
+struct EglConfigInfo egl_config_info;
+
+// Sort keys of a framebuffer configuration, the least capable one first
+struct RankedConfig
+{
+    EGLConfig config;
+    bool caveat;
+    EGLint footprint;
+    EGLint id;
+};
+
+static bool initialize_display();
+static void dispatch_x11_events();
+static bool initialize_offscreen_display();
+static bool create_window(EGLConfig egl_config, size_t index);
+static bool create_context(EGLint version);
+static bool choose_config(EGLConfig *config);
+static bool rank_configs(EGLConfig *configs, EGLint count);
+
+bool initialize_egl(EGLint version)
+{
+    context_version = version;
+
+    if (!initialize_display())
+    {
+        return false;
+    }
+
+    EGLConfig egl_config;
+    if (!choose_config(&egl_config))
+    {
+        return false;
+    }
+
+    startup_stage_finished("choose config");
+
+    return egl_create_surface(egl_config);
+}
+
+static bool initialize_display()
 {
+    if (options.offscreen_width > 0)
+    {
+        return initialize_offscreen_display();
+    }
+
     // Open X11 display
     x11_display = XOpenDisplay(NULL);
 
@@ -38,6 +107,14 @@ bool initialize_egl()
         return false;
     }
 
+    // Events are read whenever the connection becomes readable instead of polling every frame
+    if (!add_event_source(ConnectionNumber(x11_display), dispatch_x11_events))
+    {
+        return false;
+    }
+
+    startup_stage_finished("open X11 display");
+
     // Get EGL display
     char const *egl_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
 
@@ -65,25 +142,126 @@ bool initialize_egl()
         return false;
     }
 
-    // Choose framebuffer configuration
-#ifdef NIGHTMARE_USE_GLES1
-    EGLint renderable_type = EGL_OPENGL_ES_BIT;
-#elif defined NIGHTMARE_USE_GLES2
-    EGLint renderable_type = EGL_OPENGL_ES2_BIT;
-#endif
+    startup_stage_finished("initialize EGL display");
+
+    // Get screen size
+    XWindowAttributes root_window_attributes;
+    Window root_window = RootWindow(x11_display, DefaultScreen(x11_display));
+    Status x11_status = XGetWindowAttributes(x11_display, root_window, &root_window_attributes);
+    if (!x11_status)
+    {
+        print_error("Could not retrieve screen size via X11\n");
+        return false;
+    }
+
+    // Several windows share the screen side by side
+    screen_width = root_window_attributes.width / options.surface_count;
+    screen_height = root_window_attributes.height;
+    render_width = screen_width;
+    render_height = screen_height;
 
-    const EGLint attribute_list[] = {
+    return true;
+}
+
+static bool initialize_offscreen_display()
+{
+    char const *egl_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (!egl_extensions)
+    {
+        print_error("Could not query EGL extensions\n");
+        return false;
+    }
+
+    if (!strstr(egl_extensions, "EGL_EXT_platform_base") || !strstr(egl_extensions, "EGL_MESA_platform_surfaceless"))
+    {
+        print_error("Offscreen rendering requires the EGL extensions EGL_EXT_platform_base and EGL_MESA_platform_surfaceless\n");
+        return false;
+    }
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    egl_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+    EGLBoolean egl_success = eglInitialize(egl_display, &egl_major, &egl_minor);
+
+    if (!egl_success)
+    {
+        print_error("Could not initialize EGL\n");
+        return false;
+    }
+
+    startup_stage_finished("initialize EGL display");
+
+    offscreen = true;
+    screen_width = options.offscreen_width;
+    screen_height = options.offscreen_height;
+    render_width = screen_width;
+    render_height = screen_height;
+
+    return true;
+}
+
+static bool choose_config(EGLConfig *config)
+{
+    EGLConfig *configs;
+    EGLint config_count;
+    if (!egl_get_configs(&configs, &config_count))
+    {
+        return false;
+    }
+
+    // Configurations are ranked, the first one has the smallest footprint
+    (*config) = configs[0];
+    free(configs);
+
+    return true;
+}
+
+bool egl_get_configs(EGLConfig **configs, EGLint *count)
+{
+    // Choose framebuffer configuration
+    EGLint attribute_list[] = {
         EGL_RED_SIZE, 8,
         EGL_GREEN_SIZE, 8,
         EGL_BLUE_SIZE, 8,
         EGL_ALPHA_SIZE, 8,
-        EGL_RENDERABLE_TYPE, renderable_type,
+        EGL_RENDERABLE_TYPE, egl_renderable_type,
+        EGL_SURFACE_TYPE, offscreen ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
+        EGL_NONE, 0,
+        EGL_NONE, 0,
         EGL_NONE};
 
+    // Multisampling is a property of the framebuffer configuration
+    EGLint samples = options.antialiasing == ANTIALIASING_MSAA2   ? 2
+                     : options.antialiasing == ANTIALIASING_MSAA4 ? 4
+                                                                  : 0;
+    if (samples > 0)
+    {
+        attribute_list[12] = EGL_SAMPLE_BUFFERS;
+        attribute_list[13] = 1;
+        attribute_list[14] = EGL_SAMPLES;
+        attribute_list[15] = samples;
+    }
+
+    if (options.config_id > 0)
+    {
+        // All other attributes are ignored if a configuration id is given
+        attribute_list[0] = EGL_CONFIG_ID;
+        attribute_list[1] = options.config_id;
+        attribute_list[2] = EGL_NONE;
+    }
+    else if (options.color_format == COLOR_FORMAT_RGB565)
+    {
+        attribute_list[1] = 5;
+        attribute_list[3] = 6;
+        attribute_list[5] = 5;
+        attribute_list[7] = 0;
+    }
+
     // Get number of matching framebuffer configurations
     EGLint found_configs = 0;
-    egl_success = eglChooseConfig(egl_display, attribute_list, NULL, 0, &found_configs);
-    if (!egl_success || found_configs == 0)
+    EGLBoolean egl_success = eglChooseConfig(egl_display, attribute_list, NULL, 0, &found_configs);
+    if (!egl_success)
     {
         print_error("Failed to query framebuffer configurations\n");
         return false;
@@ -98,56 +276,268 @@ bool initialize_egl()
 
     // Get matching framebuffer configurations
     EGLint config_count = found_configs;
-    EGLConfig *configs = (EGLConfig *)calloc(sizeof(EGLConfig), (size_t)config_count);
-    egl_success = eglChooseConfig(egl_display, attribute_list, configs, config_count, &found_configs);
+    EGLConfig *matched_configs = (EGLConfig *)calloc(sizeof(EGLConfig), (size_t)config_count);
+    egl_success = eglChooseConfig(egl_display, attribute_list, matched_configs, config_count, &found_configs);
     if (!egl_success)
     {
-        free(configs);
+        free(matched_configs);
         print_error("Could not retrieve matched framebuffer configurations\n");
         return false;
     }
     else if (config_count != found_configs)
     {
-        free(configs);
+        free(matched_configs);
         print_error("Different counts of supported framebuffer configurations after back to back call\n");
         return false;
     }
 
-    // Choose framebuffer configuration
-    // TODO: currently selecting the first result. selecting the one with the least capabilities would be better
-    EGLConfig egl_config = configs[0];
-    EGLint config_id = 0;
-    if (!eglGetConfigAttrib(egl_display, egl_config, EGL_CONFIG_ID, &config_id))
+    // eglChooseConfig sorts the largest colour buffers first, we prefer the least capable configuration
+    if (!rank_configs(matched_configs, config_count))
     {
-        free(configs);
-        print_error("Could not retrieve id from framebuffer configuration\n");
+        free(matched_configs);
         return false;
     }
 
-    EGLint native_id;
-    if (!eglGetConfigAttrib(egl_display, egl_config, EGL_NATIVE_VISUAL_ID, &native_id))
+    (*configs) = matched_configs;
+    (*count) = config_count;
+
+    return true;
+}
+
+bool egl_describe_config(EGLConfig config, struct EglConfigInfo *info)
+{
+    bool success = eglGetConfigAttrib(egl_display, config, EGL_CONFIG_ID, &info->id) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_RED_SIZE, &info->red_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_GREEN_SIZE, &info->green_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_BLUE_SIZE, &info->blue_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_ALPHA_SIZE, &info->alpha_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_DEPTH_SIZE, &info->depth_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_STENCIL_SIZE, &info->stencil_size) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_SAMPLES, &info->samples) &&
+                   eglGetConfigAttrib(egl_display, config, EGL_CONFIG_CAVEAT, &info->caveat);
+
+    if (!success)
     {
-        free(configs);
-        print_error("Could not retrieve X11 id from framebuffer configuration\n");
+        print_error("Could not retrieve attributes of framebuffer configuration\n");
+    }
+
+    return success;
+}
+
+// Bits stored per pixel, multisampled buffers store every sample
+static EGLint get_footprint(const struct EglConfigInfo *info)
+{
+    EGLint bits = info->red_size + info->green_size + info->blue_size + info->alpha_size +
+                  info->depth_size + info->stencil_size;
+    return bits * (info->samples > 1 ? info->samples : 1);
+}
+
+static int compare_ranked_configs(const void *a, const void *b)
+{
+    const struct RankedConfig *ranked_a = a;
+    const struct RankedConfig *ranked_b = b;
+
+    // Slow or non-conformant configurations last
+    if (ranked_a->caveat != ranked_b->caveat)
+    {
+        return ranked_a->caveat ? 1 : -1;
+    }
+
+    if (ranked_a->footprint != ranked_b->footprint)
+    {
+        return ranked_a->footprint < ranked_b->footprint ? -1 : 1;
+    }
+
+    return ranked_a->id - ranked_b->id;
+}
+
+// Sorts the configurations by their ranking, which is queried once per configuration up front
+static bool rank_configs(EGLConfig *configs, EGLint count)
+{
+    struct RankedConfig *ranked_configs = malloc(sizeof(struct RankedConfig) * (size_t)count);
+    if (!ranked_configs)
+    {
+        print_error("Failed to allocate memory for ranking the framebuffer configurations\n");
         return false;
     }
 
-    free(configs);
+    for (EGLint i = 0; i < count; i++)
+    {
+        struct EglConfigInfo info;
+        if (!egl_describe_config(configs[i], &info))
+        {
+            free(ranked_configs);
+            return false;
+        }
 
-    // Get screen size
-    XWindowAttributes root_window_attributes;
-    Window root_window = RootWindow(x11_display, DefaultScreen(x11_display));
-    Status x11_status = XGetWindowAttributes(x11_display, root_window, &root_window_attributes);
-    screen_width = root_window_attributes.width;
-    screen_height = root_window_attributes.height;
+        ranked_configs[i] = (struct RankedConfig){
+            .config = configs[i],
+            .caveat = info.caveat != EGL_NONE,
+            .footprint = get_footprint(&info),
+            .id = info.id,
+        };
+    }
 
-    if (!x11_status)
+    qsort(ranked_configs, (size_t)count, sizeof(struct RankedConfig), compare_ranked_configs);
+
+    for (EGLint i = 0; i < count; i++)
     {
-        print_error("Could not retrieve screen size via X11\n");
+        configs[i] = ranked_configs[i].config;
+    }
+
+    free(ranked_configs);
+    return true;
+}
+
+bool egl_recreate_surface()
+{
+    egl_destroy_surface();
+
+    EGLConfig egl_config;
+    if (!choose_config(&egl_config))
+    {
+        return false;
+    }
+
+    return egl_create_surface(egl_config);
+}
+
+bool egl_create_surface(EGLConfig egl_config)
+{
+    if (!egl_describe_config(egl_config, &egl_config_info))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < (size_t)options.surface_count; i++)
+    {
+        EGLSurface surface;
+        if (offscreen)
+        {
+            EGLint pbuffer_attributes[] = {
+                EGL_WIDTH, screen_width,
+                EGL_HEIGHT, screen_height,
+                EGL_NONE};
+
+            surface = eglCreatePbufferSurface(egl_display, egl_config, pbuffer_attributes);
+        }
+        else if (create_window(egl_config, i))
+        {
+            surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)x11_windows[i], NULL);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (!surface)
+        {
+            print_error("Could not create EGL surface (error code: %x)\n", eglGetError());
+            return false;
+        }
+
+        egl_surfaces[surface_count++] = surface;
+    }
+    egl_surface = egl_surfaces[0];
+
+    startup_stage_finished("create surface");
+
+    surface_config = egl_config;
+    if (!create_context(context_version))
+    {
+        return false;
+    }
+
+    startup_stage_finished("create context");
+
+    if (offscreen)
+    {
+        return true;
+    }
+
+    // Set zero time swapping, the swap interval belongs to the current surface (the first one in the end)
+    for (size_t i = surface_count; i-- > 0;)
+    {
+        if (!egl_select_surface(i))
+        {
+            return false;
+        }
+
+        EGLBoolean egl_success = eglSwapInterval(egl_display, 0);
+        if (!egl_success)
+        {
+            print_error("Could not set zero time swapping (error code: %x)\n", eglGetError());
+            return false;
+        }
+
+        XMapWindow(x11_display, x11_windows[i]);
+    }
+
+    startup_stage_finished("map window");
+
+    return true;
+}
+
+static bool create_context(EGLint version)
+{
+    EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, version,
+        EGL_NONE};
+
+    egl_contexts[version] = eglCreateContext(egl_display, surface_config,
+                                             EGL_NO_CONTEXT, context_attributes);
+    if (egl_contexts[version] == EGL_NO_CONTEXT)
+    {
+        print_error("Could not create GLES %i context (error code: %x)\n", version, eglGetError());
+        return false;
+    }
+
+    // Make current
+    EGLBoolean egl_success = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_contexts[version]);
+    if (!egl_success)
+    {
+        print_error("Could not set EGL context as current one (error code: %x)\n", eglGetError());
+        return false;
+    }
+
+    return true;
+}
+
+// Switches to the context of the given GLES version, a destroyed surface is recreated
+bool egl_make_current(EGLint version)
+{
+    context_version = version;
+
+    if (egl_surface == EGL_NO_SURFACE)
+    {
+        return egl_recreate_surface();
+    }
+
+    if (egl_contexts[version] == EGL_NO_CONTEXT)
+    {
+        return create_context(version);
+    }
+
+    if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_contexts[version]))
+    {
+        print_error("Could not set EGL context as current one (error code: %x)\n", eglGetError());
+        return false;
+    }
+
+    return true;
+}
+
+static bool create_window(EGLConfig egl_config, size_t index)
+{
+    EGLint native_id;
+    if (!eglGetConfigAttrib(egl_display, egl_config, EGL_NATIVE_VISUAL_ID, &native_id))
+    {
+        print_error("Could not retrieve X11 id from framebuffer configuration\n");
         return false;
     }
 
     // Get XVisualInfo
+    Window root_window = RootWindow(x11_display, DefaultScreen(x11_display));
     XVisualInfo visual_info_template;
     visual_info_template.visualid = native_id;
     XVisualInfo *visual_info = NULL;
@@ -163,16 +553,20 @@ bool initialize_egl()
     // Create window
     XSetWindowAttributes set_window_attributes;
 
+    if (window_count == 0)
+    {
+        x11_colormap = XCreateColormap(x11_display, root_window, visual_info->visual, AllocNone);
+    }
     set_window_attributes.background_pixel = 0;
     set_window_attributes.border_pixel = 0;
-    set_window_attributes.colormap = XCreateColormap(x11_display, root_window, visual_info->visual, AllocNone);
+    set_window_attributes.colormap = x11_colormap;
     set_window_attributes.event_mask = 0;
     unsigned long mask = CWBackPixel | CWBorderPixel | CWColormap | CWEventMask;
 
-    x11_window = XCreateWindow(
+    Window x11_window = XCreateWindow(
         x11_display, root_window,
-        0, // x
-        0, // y
+        index * screen_width, // x
+        0,                    // y
         screen_width,
         screen_height,
         0, // Border width
@@ -190,95 +584,203 @@ bool initialize_egl()
         return false;
     }
 
-    // Full window
-    Atom fullscreen_atom = XInternAtom(x11_display, "_NET_WM_STATE_FULLSCREEN", True);
-    if (fullscreen_atom == None)
+    x11_windows[window_count++] = x11_window;
+
+    // Full window, several windows keep their place next to each other
+    if (options.surface_count == 1)
     {
-        print_error("Could not set EWMH Fullscreen hint\n");
-        return false;
-    }
+        Atom fullscreen_atom = XInternAtom(x11_display, "_NET_WM_STATE_FULLSCREEN", True);
+        if (fullscreen_atom == None)
+        {
+            print_error("Could not set EWMH Fullscreen hint\n");
+            return false;
+        }
 
-    XChangeProperty(
-        x11_display,
-        x11_window,
-        XInternAtom(x11_display, "_NET_WM_STATE", True),
-        XA_ATOM,
-        32,
-        PropModeReplace,
-        (unsigned char *)&fullscreen_atom,
-        1);
+        XChangeProperty(
+            x11_display,
+            x11_window,
+            XInternAtom(x11_display, "_NET_WM_STATE", True),
+            XA_ATOM,
+            32,
+            PropModeReplace,
+            (unsigned char *)&fullscreen_atom,
+            1);
+    }
 
     // Set window name
     XStoreName(x11_display, x11_window, "nightmare benchmark");
 
     // Gracefulle handle the window delete event
-    Atom wm_delete = XInternAtom(x11_display, "WM_DELETE_WINDOW", True);
+    wm_delete = XInternAtom(x11_display, "WM_DELETE_WINDOW", True);
     XSetWMProtocols(x11_display, x11_window, &wm_delete, 1);
 
-    // Create EGL surface
-    egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)x11_window, NULL);
-    if (!egl_surface)
+    startup_stage_finished("create window");
+
+    return true;
+}
+
+void egl_destroy_surface()
+{
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    for (size_t i = 0; i < sizeof(egl_contexts) / sizeof(egl_contexts[0]); i++)
     {
-        print_error("Could not create EGL surface (error code: %x)\n", eglGetError());
-        return false;
+        if (egl_contexts[i] != EGL_NO_CONTEXT)
+        {
+            eglDestroyContext(egl_display, egl_contexts[i]);
+            egl_contexts[i] = EGL_NO_CONTEXT;
+        }
     }
 
-    // Create context
-#ifdef NIGHTMARE_USE_GLES1
-    EGLint context_attributes[] = {
-        EGL_CONTEXT_MAJOR_VERSION, 1,
-        EGL_NONE};
-#elif defined NIGHTMARE_USE_GLES2
-    EGLint context_attributes[] = {
-        EGL_CONTEXT_MAJOR_VERSION, 2,
-        EGL_NONE};
-#endif
+    for (size_t i = 0; i < surface_count; i++)
+    {
+        eglDestroySurface(egl_display, egl_surfaces[i]);
+    }
+    surface_count = 0;
+    egl_surface = EGL_NO_SURFACE;
 
-    EGLContext egl_context = eglCreateContext(egl_display, egl_config,
-                                              EGL_NO_CONTEXT, context_attributes);
+    for (size_t i = 0; i < window_count; i++)
+    {
+        XDestroyWindow(x11_display, x11_windows[i]);
+    }
 
-    // Make current
-    egl_success = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
-    if (!egl_success)
+    if (window_count > 0)
     {
-        print_error("Could not set EGL context as current one (error code: %x)\n", eglGetError());
-        return false;
+        XFreeColormap(x11_display, x11_colormap);
+        window_count = 0;
     }
+}
 
-    // Set zero time swapping
-    egl_success = eglSwapInterval(egl_display, 0);
-    if (!egl_success)
+size_t egl_get_surface_count()
+{
+    return surface_count;
+}
+
+// Makes the surface current for the context in use, every surface shares its objects
+bool egl_select_surface(size_t index)
+{
+    egl_surface = egl_surfaces[index];
+
+    if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_contexts[context_version]))
     {
-        print_error("Could not set zero time swapping (error code: %x)\n", eglGetError());
+        print_error("Could not make surface %zu current (error code: %x)\n", index, eglGetError());
         return false;
     }
 
-    XMapWindow(x11_display, x11_window);
-
     return true;
 }
 
 void cleanup_egl()
 {
+    if (x11_display || offscreen)
+    {
+        egl_destroy_surface();
+    }
+
     eglTerminate(egl_display);
 
     if (x11_display)
     {
-        XDestroyWindow(x11_display, x11_window);
-
+        remove_event_source(ConnectionNumber(x11_display));
         XCloseDisplay(x11_display);
         x11_display = NULL;
     }
 }
 
-void egl_loop_step()
+bool egl_initialize_partial_update()
 {
-    XEvent event;
-    if (XPending(x11_display))
+    char const *egl_extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+
+    if (!egl_extensions)
+    {
+        print_error("Could not query EGL display extensions\n");
+        return false;
+    }
+
+    bool has_buffer_age = strstr(egl_extensions, "EGL_EXT_buffer_age") != NULL;
+    bool has_partial_update = strstr(egl_extensions, "EGL_KHR_partial_update") != NULL;
+
+    if (!has_buffer_age && !has_partial_update)
+    {
+        print_error("On this device EGL supports neither EGL_EXT_buffer_age nor EGL_KHR_partial_update\n");
+        return false;
+    }
+
+    if (has_partial_update)
     {
-        if (XCheckWindowEvent(x11_display, x11_window, 0, &event))
+        set_damage_region = (PFNEGLSETDAMAGEREGIONKHRPROC)eglGetProcAddress("eglSetDamageRegionKHR");
+    }
+
+    if (strstr(egl_extensions, "EGL_KHR_swap_buffers_with_damage"))
+    {
+        swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    }
+    else if (strstr(egl_extensions, "EGL_EXT_swap_buffers_with_damage"))
+    {
+        swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    }
+
+    if (!swap_buffers_with_damage)
+    {
+        print("EGL can not swap buffers with damage, the compositor will receive the full surface as damage\n");
+    }
+
+    return true;
+}
+
+EGLint egl_query_buffer_age()
+{
+    // EGL_BUFFER_AGE_EXT and EGL_BUFFER_AGE_KHR share the same value
+    EGLint age = 0;
+    if (!eglQuerySurface(egl_display, egl_surface, EGL_BUFFER_AGE_EXT, &age))
+    {
+        return 0;
+    }
+
+    return age;
+}
+
+void egl_set_damage_region(EGLint *rects, EGLint rect_count)
+{
+    if (set_damage_region)
+    {
+        set_damage_region(egl_display, egl_surface, rects, rect_count);
+    }
+}
+
+void egl_swap_buffers_with_damage(const EGLint *rects, EGLint rect_count)
+{
+    if (swap_buffers_with_damage)
+    {
+        swap_buffers_with_damage(egl_display, egl_surface, rects, rect_count);
+    }
+    else
+    {
+        eglSwapBuffers(egl_display, egl_surface);
+    }
+}
+
+bool egl_is_offscreen()
+{
+    return offscreen;
+}
+
+// Called by the event loop whenever the X11 connection is readable
+static void dispatch_x11_events()
+{
+    while (XPending(x11_display))
+    {
+        XEvent event;
+        XNextEvent(x11_display, &event);
+
+        // Closing the window ends the run like an interrupt
+        if (event.type == ClientMessage && (Atom)event.xclient.data.l[0] == wm_delete)
+        {
+            sigint_triggered = 1;
+        }
+        else
         {
-            // Should never be reached as all events are masked
+            // Should never be reached as all other events are masked
             print("received x11 event: %i\n", event.type);
         }
     }
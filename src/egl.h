@@ -3,22 +3,58 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdbool.h>
 #include <X11/Xlib.h>
 #include <EGL/egl.h>
 
 extern Display *x11_display;
-extern Window x11_window;
 
 extern int egl_major;
 extern int egl_minor;
 extern EGLDisplay egl_display;
 extern EGLSurface egl_surface;
+// EGL_RENDERABLE_TYPE bits the framebuffer configuration has to support, set before initialize_egl()
+extern EGLint egl_renderable_type;
 
 extern int screen_width;
 extern int screen_height;
 
-bool initialize_egl();
+// Size scenes render at, smaller than the screen when render scaling is active
+extern int render_width;
+extern int render_height;
+
+struct EglConfigInfo
+{
+    EGLint id;
+    EGLint red_size;
+    EGLint green_size;
+    EGLint blue_size;
+    EGLint alpha_size;
+    EGLint depth_size;
+    EGLint stencil_size;
+    EGLint samples;
+    EGLint caveat;
+};
+
+// Framebuffer configuration of the current surface
+extern struct EglConfigInfo egl_config_info;
+
+bool initialize_egl(EGLint version);
 void cleanup_egl();
 
-void egl_loop_step();
+bool egl_get_configs(EGLConfig **configs, EGLint *count);
+bool egl_describe_config(EGLConfig config, struct EglConfigInfo *info);
+bool egl_create_surface(EGLConfig config);
+void egl_destroy_surface();
+bool egl_recreate_surface();
+bool egl_make_current(EGLint version);
+size_t egl_get_surface_count();
+bool egl_select_surface(size_t index);
+
+bool egl_initialize_partial_update();
+EGLint egl_query_buffer_age();
+void egl_set_damage_region(EGLint *rects, EGLint rect_count);
+void egl_swap_buffers_with_damage(const EGLint *rects, EGLint rect_count);
+
+bool egl_is_offscreen();
@@ -0,0 +1,200 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "event-loop.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "common.h"
+#include "signal-handler.h"
+
+/*
+ * Event loop
+ *
+ * Everything the benchmark waits for is a file descriptor in one epoll set:
+ * the X11 connection, the signals and a timer for frame and update
+ * deadlines. Waiting for a deadline blocks in epoll_wait() instead of
+ * spinning, while X11 events and interrupts are still handled as they
+ * arrive.
+ */
+
+#define MAX_EVENT_SOURCES 8
+#define MAX_EVENTS 8
+// Marks the timer in the epoll event data, sources use their index
+#define TIMER_SOURCE MAX_EVENT_SOURCES
+
+struct EventSource
+{
+    int fd;
+    void (*dispatch)();
+};
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static struct EventSource sources[MAX_EVENT_SOURCES];
+static size_t source_count = 0;
+
+bool initialize_event_loop()
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        print_error("Could not create epoll instance\n");
+        return false;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        print_error("Could not create deadline timer\n");
+        cleanup_event_loop();
+        return false;
+    }
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = TIMER_SOURCE};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) != 0)
+    {
+        print_error("Could not watch deadline timer\n");
+        cleanup_event_loop();
+        return false;
+    }
+
+    return true;
+}
+
+void cleanup_event_loop()
+{
+    if (timer_fd >= 0)
+    {
+        close(timer_fd);
+    }
+
+    if (epoll_fd >= 0)
+    {
+        close(epoll_fd);
+    }
+
+    timer_fd = -1;
+    epoll_fd = -1;
+    source_count = 0;
+}
+
+bool add_event_source(int fd, void (*dispatch)())
+{
+    if (source_count >= MAX_EVENT_SOURCES)
+    {
+        print_error("Too many event sources\n");
+        return false;
+    }
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = source_count};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        print_error("Could not watch file descriptor %i\n", fd);
+        return false;
+    }
+
+    sources[source_count].fd = fd;
+    sources[source_count].dispatch = dispatch;
+    source_count++;
+
+    return true;
+}
+
+void remove_event_source(int fd)
+{
+    for (size_t i = 0; i < source_count; i++)
+    {
+        if (sources[i].fd != fd)
+        {
+            continue;
+        }
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+        // The last source takes the free index
+        source_count--;
+        if (i < source_count)
+        {
+            sources[i] = sources[source_count];
+            struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sources[i].fd, &event);
+        }
+        return;
+    }
+}
+
+// Returns whether waiting for the deadline is over
+static bool process_events(int timeout_ms)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (count < 0)
+    {
+        // Anything but an interrupted wait means the set is broken, do not spin on it
+        return errno != EINTR;
+    }
+
+    bool expired = false;
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t source = events[i].data.u32;
+        if (source == TIMER_SOURCE)
+        {
+            uint64_t expirations;
+            expired = read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations) || expired;
+        }
+        else if (source < source_count)
+        {
+            sources[source].dispatch();
+        }
+    }
+
+    return expired;
+}
+
+void dispatch_events()
+{
+    if (epoll_fd >= 0)
+    {
+        process_events(0);
+    }
+}
+
+void wait_for_deadline(int64_t deadline_ns)
+{
+    if (epoll_fd < 0)
+    {
+        struct timespec deadline = {deadline_ns / SEC_IN_NS, deadline_ns % SEC_IN_NS};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        return;
+    }
+
+    // A zero expiration would disarm the timer instead of firing it
+    struct itimerspec timer = {
+        .it_interval = {0, 0},
+        .it_value = {deadline_ns / SEC_IN_NS, deadline_ns % SEC_IN_NS},
+    };
+    if (timer.it_value.tv_sec == 0 && timer.it_value.tv_nsec == 0)
+    {
+        timer.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) != 0)
+    {
+        return;
+    }
+
+    bool finished = false;
+    while (!finished && !sigint_triggered)
+    {
+        finished = process_events(-1);
+    }
+
+    // Leave no expiration behind for the next wait
+    struct itimerspec disarm = {{0, 0}, {0, 0}};
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &disarm, NULL);
+}
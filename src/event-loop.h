@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool initialize_event_loop();
+void cleanup_event_loop();
+
+// Calls dispatch whenever fd becomes readable while events are dispatched
+bool add_event_source(int fd, void (*dispatch)());
+void remove_event_source(int fd);
+
+// Dispatches the pending events without blocking
+void dispatch_events();
+// Blocks and dispatches events until the CLOCK_MONOTONIC time deadline_ns
+// passed or an interrupt was received
+void wait_for_deadline(int64_t deadline_ns);
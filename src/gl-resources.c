@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "gl-resources.h"
+
+#include <string.h>
+#include "common.h"
+
+/*
+ * GL resource registry
+ *
+ * Every GL object and every piece of enabled state is registered here when
+ * created. Scenes delete them on deinitialize; whatever is left afterwards
+ * is reported as leaked and released, so the next scene starts clean.
+ */
+
+#define MAX_GL_RESOURCES 256
+#define MAX_GL_STATES 32
+
+struct GlResource
+{
+    enum GlResourceType type;
+    GLuint name;
+    uint64_t serial;
+};
+
+struct GlState
+{
+    enum GlStateType type;
+    GLuint value;
+};
+
+static const char *resource_type_names[GL_RESOURCE_TYPE_COUNT] = {
+    [GL_RESOURCE_BUFFER] = "buffer",
+    [GL_RESOURCE_TEXTURE] = "texture",
+#ifdef NIGHTMARE_USE_GLES2
+    [GL_RESOURCE_FRAMEBUFFER] = "framebuffer",
+    [GL_RESOURCE_PROGRAM] = "program",
+    [GL_RESOURCE_SHADER] = "shader",
+#endif
+};
+
+static struct GlResource resources[MAX_GL_RESOURCES];
+static size_t resources_count = 0;
+static uint64_t next_serial = 0;
+
+static struct GlState states[MAX_GL_STATES];
+static size_t states_count = 0;
+
+void register_gl_resource(enum GlResourceType type, GLuint name)
+{
+    if (resources_count >= MAX_GL_RESOURCES)
+    {
+        print_error("Too many GL resources, %s %u is not tracked\n", resource_type_names[type], name);
+        return;
+    }
+
+    struct GlResource resource = {type, name, next_serial++};
+    resources[resources_count++] = resource;
+}
+
+static void delete_object(enum GlResourceType type, GLuint name)
+{
+    switch (type)
+    {
+    case GL_RESOURCE_BUFFER:
+        glDeleteBuffers(1, &name);
+        break;
+    case GL_RESOURCE_TEXTURE:
+        glDeleteTextures(1, &name);
+        break;
+#ifdef NIGHTMARE_USE_GLES2
+    case GL_RESOURCE_FRAMEBUFFER:
+        glDeleteFramebuffers(1, &name);
+        break;
+    case GL_RESOURCE_PROGRAM:
+        glDeleteProgram(name);
+        break;
+    case GL_RESOURCE_SHADER:
+        glDeleteShader(name);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+static void remove_resource(size_t index)
+{
+    memmove(&resources[index], &resources[index + 1], (resources_count - index - 1) * sizeof(struct GlResource));
+    resources_count--;
+}
+
+void delete_gl_resource(enum GlResourceType type, GLuint name)
+{
+    delete_object(type, name);
+
+    for (size_t i = 0; i < resources_count; i++)
+    {
+        if (resources[i].type == type && resources[i].name == name)
+        {
+            remove_resource(i);
+            return;
+        }
+    }
+}
+
+static void apply_state(enum GlStateType type, GLuint value, bool enable)
+{
+    switch (type)
+    {
+    case GL_STATE_CAPABILITY:
+        enable ? glEnable(value) : glDisable(value);
+        break;
+#ifdef NIGHTMARE_USE_GLES1
+    case GL_STATE_CLIENT_STATE:
+        enable ? glEnableClientState(value) : glDisableClientState(value);
+        break;
+#elif defined NIGHTMARE_USE_GLES2
+    case GL_STATE_VERTEX_ATTRIB_ARRAY:
+        enable ? glEnableVertexAttribArray(value) : glDisableVertexAttribArray(value);
+        break;
+#endif
+    }
+}
+
+void enable_gl_state(enum GlStateType type, GLuint value)
+{
+    apply_state(type, value, true);
+
+    for (size_t i = 0; i < states_count; i++)
+    {
+        if (states[i].type == type && states[i].value == value)
+        {
+            return;
+        }
+    }
+
+    if (states_count >= MAX_GL_STATES)
+    {
+        print_error("Too many enabled GL states, state %x is not tracked\n", value);
+        return;
+    }
+
+    struct GlState state = {type, value};
+    states[states_count++] = state;
+}
+
+void disable_gl_state(enum GlStateType type, GLuint value)
+{
+    apply_state(type, value, false);
+
+    for (size_t i = 0; i < states_count; i++)
+    {
+        if (states[i].type == type && states[i].value == value)
+        {
+            states[i] = states[--states_count];
+            return;
+        }
+    }
+}
+
+uint64_t get_gl_resources_mark()
+{
+    return next_serial;
+}
+
+size_t release_gl_resources(uint64_t mark)
+{
+    size_t released = 0;
+
+    size_t i = 0;
+    while (i < resources_count)
+    {
+        if (resources[i].serial < mark)
+        {
+            i++;
+            continue;
+        }
+
+        print_error("Leaked GL %s %u\n", resource_type_names[resources[i].type], resources[i].name);
+        delete_object(resources[i].type, resources[i].name);
+        remove_resource(i);
+        released++;
+    }
+
+    return released;
+}
+
+size_t reset_gl_state()
+{
+    size_t reset = states_count;
+
+    for (size_t i = 0; i < states_count; i++)
+    {
+        print_error("Leaked GL state %x\n", states[i].value);
+        apply_state(states[i].type, states[i].value, false);
+    }
+    states_count = 0;
+
+    // Bindings and the current program are not objects of their own, so they are always reset
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+#ifdef NIGHTMARE_USE_GLES2
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glUseProgram(0);
+#endif
+    glLineWidth(1.0f);
+
+    return reset;
+}
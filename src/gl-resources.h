@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef NIGHTMARE_USE_GLES1
+#include <GLES/gl.h>
+#elif defined NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+#endif
+
+enum GlResourceType
+{
+    GL_RESOURCE_BUFFER,
+    GL_RESOURCE_TEXTURE,
+#ifdef NIGHTMARE_USE_GLES2
+    GL_RESOURCE_FRAMEBUFFER,
+    GL_RESOURCE_PROGRAM,
+    GL_RESOURCE_SHADER,
+#endif
+    GL_RESOURCE_TYPE_COUNT,
+};
+
+enum GlStateType
+{
+    // glEnable/glDisable
+    GL_STATE_CAPABILITY,
+#ifdef NIGHTMARE_USE_GLES1
+    // glEnableClientState/glDisableClientState
+    GL_STATE_CLIENT_STATE,
+#elif defined NIGHTMARE_USE_GLES2
+    // glEnableVertexAttribArray/glDisableVertexAttribArray
+    GL_STATE_VERTEX_ATTRIB_ARRAY,
+#endif
+};
+
+void register_gl_resource(enum GlResourceType type, GLuint name);
+void delete_gl_resource(enum GlResourceType type, GLuint name);
+
+void enable_gl_state(enum GlStateType type, GLuint value);
+void disable_gl_state(enum GlStateType type, GLuint value);
+
+// Resources registered after the mark can be released (and reported) as leaked
+uint64_t get_gl_resources_mark();
+size_t release_gl_resources(uint64_t mark);
+size_t reset_gl_state();
@@ -0,0 +1,616 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "harness.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "common.h"
+#include "options.h"
+#include "results.h"
+#include "results-file.h"
+#include "results-format.h"
+#include "statistics.h"
+
+/*
+ * Harness
+ *
+ * Runs several copies of the benchmark at once to measure how they contend
+ * for the GPU. The copies are forked after the options are parsed and run
+ * the selected scenes as usual, each on its own offscreen surface, with the
+ * output and results redirected to files in a temporary directory. A barrier
+ * in shared memory lines up the start of every scene, so the frames of all
+ * copies overlap. Once every copy exited, the parent reads their results and
+ * reports the frame rate per copy and in aggregate, how fairly the GPU was
+ * shared and the tail of the frame times across all copies. The combined
+ * results keep the environment and startup records of the copies, those
+ * which differ between them are prefixed with the copy.
+ */
+
+// Shared by every copy, the parent owns the count of running copies
+struct Barrier
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t released;
+    int running_count;
+    int arrived_count;
+    // Incremented every time the waiting copies are released
+    uint64_t generation;
+};
+
+static struct Barrier *barrier = NULL;
+static pid_t process_ids[MAX_PROCESSES];
+static int process_count = 0;
+// Index of this copy, -1 in the parent
+static int process_index = -1;
+static char directory[64];
+// Combined results of the parent (NULL if not written)
+static const char *combined_results_path = NULL;
+static char child_results_path[128];
+
+static const char *process_metric_names[MAX_PROCESSES] = {
+    "process0_fps", "process1_fps", "process2_fps", "process3_fps",
+    "process4_fps", "process5_fps", "process6_fps", "process7_fps",
+    "process8_fps", "process9_fps", "process10_fps", "process11_fps",
+    "process12_fps", "process13_fps", "process14_fps", "process15_fps",
+};
+
+static void lock_barrier()
+{
+    // A copy which died while holding the mutex left nothing half updated
+    if (pthread_mutex_lock(&barrier->mutex) == EOWNERDEAD)
+    {
+        pthread_mutex_consistent(&barrier->mutex);
+    }
+}
+
+static void release_barrier()
+{
+    barrier->arrived_count = 0;
+    barrier->generation++;
+    pthread_cond_broadcast(&barrier->released);
+}
+
+static bool create_barrier(int count)
+{
+    barrier = mmap(NULL, sizeof(struct Barrier), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (barrier == MAP_FAILED)
+    {
+        barrier = NULL;
+        print_error("Could not map the harness barrier\n");
+        return false;
+    }
+
+    pthread_mutexattr_t mutex_attributes;
+    pthread_mutexattr_init(&mutex_attributes);
+    pthread_mutexattr_setpshared(&mutex_attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutex_attributes, PTHREAD_MUTEX_ROBUST);
+    int mutex_error = pthread_mutex_init(&barrier->mutex, &mutex_attributes);
+    pthread_mutexattr_destroy(&mutex_attributes);
+
+    pthread_condattr_t condition_attributes;
+    pthread_condattr_init(&condition_attributes);
+    pthread_condattr_setpshared(&condition_attributes, PTHREAD_PROCESS_SHARED);
+    int condition_error = pthread_cond_init(&barrier->released, &condition_attributes);
+    pthread_condattr_destroy(&condition_attributes);
+
+    if (mutex_error != 0 || condition_error != 0)
+    {
+        print_error("Could not initialize the harness barrier\n");
+        return false;
+    }
+
+    barrier->running_count = count;
+    barrier->arrived_count = 0;
+    barrier->generation = 0;
+
+    return true;
+}
+
+// Runs in the copy with the given index after the fork
+static bool start_child(int index, int count)
+{
+    process_index = index;
+    process_count = count;
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/process-%i.log", directory, index);
+    if (!freopen(path, "w", stdout))
+    {
+        print_error("Process %i could not open its log '%s'\n", index, path);
+        return false;
+    }
+
+    snprintf(child_results_path, sizeof(child_results_path), "%s/process-%i.txt", directory, index);
+    options.results_path = child_results_path;
+
+    char value[16];
+    snprintf(value, sizeof(value), "%i", index);
+    results_set_environment("harness_process", value);
+    snprintf(value, sizeof(value), "%i", process_count);
+    results_set_environment("harness_processes", value);
+
+    return true;
+}
+
+bool start_harness(int count)
+{
+    snprintf(directory, sizeof(directory), "/tmp/nightmare-harness-XXXXXX");
+    if (!mkdtemp(directory))
+    {
+        print_error("Could not create a directory for the harness results\n");
+        return false;
+    }
+
+    if (!create_barrier(count))
+    {
+        return false;
+    }
+
+    combined_results_path = options.results_path;
+
+    // Buffered output would otherwise be written by every copy again
+    fflush(stdout);
+    fflush(stderr);
+
+    for (process_count = 0; process_count < count; process_count++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            print_error("Could not start process %i\n", process_count);
+
+            // The started copies must not wait for the missing ones at the barrier
+            lock_barrier();
+            barrier->running_count -= count - process_count;
+            if (barrier->arrived_count > 0 && barrier->arrived_count >= barrier->running_count)
+            {
+                release_barrier();
+            }
+            pthread_mutex_unlock(&barrier->mutex);
+            break;
+        }
+        else if (pid == 0)
+        {
+            if (!start_child(process_count, count))
+            {
+                // Skips the cleanup handlers of the parent
+                _exit(1);
+            }
+
+            return true;
+        }
+
+        process_ids[process_count] = pid;
+    }
+
+    // An interrupt stops the copies, the parent still collects what they wrote
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+
+    print("Started %i processes, output in %s\n\n", process_count, directory);
+
+    return process_count > 0;
+}
+
+bool is_harness_parent()
+{
+    return barrier && process_index < 0;
+}
+
+void synchronize_harness()
+{
+    if (!barrier || process_index < 0)
+    {
+        return;
+    }
+
+    lock_barrier();
+
+    uint64_t generation = barrier->generation;
+    barrier->arrived_count++;
+    if (barrier->arrived_count >= barrier->running_count)
+    {
+        release_barrier();
+    }
+    else
+    {
+        while (generation == barrier->generation)
+        {
+            if (pthread_cond_wait(&barrier->released, &barrier->mutex) == EOWNERDEAD)
+            {
+                pthread_mutex_consistent(&barrier->mutex);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&barrier->mutex);
+}
+
+// Reaps every copy, each one which exits no longer counts towards the barrier
+static bool wait_for_processes()
+{
+    bool success = true;
+
+    for (int reaped = 0; reaped < process_count;)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        int index = 0;
+        while (index < process_count && process_ids[index] != pid)
+        {
+            index++;
+        }
+        if (index == process_count)
+        {
+            continue;
+        }
+        reaped++;
+
+        lock_barrier();
+        barrier->running_count--;
+        if (barrier->arrived_count > 0 && barrier->arrived_count >= barrier->running_count)
+        {
+            release_barrier();
+        }
+        pthread_mutex_unlock(&barrier->mutex);
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            continue;
+        }
+
+        if (WIFSIGNALED(status))
+        {
+            print_error("Process %i was terminated by signal %i\n", index, WTERMSIG(status));
+        }
+        else
+        {
+            print_error("Process %i failed with status %i\n", index, WEXITSTATUS(status));
+        }
+        success = false;
+    }
+
+    return success;
+}
+
+// Scenes ran with the same parameters in another copy
+static const struct ResultsFileScene *find_scene(const struct ResultsFile *results, const struct ResultsFileScene *scene)
+{
+    for (size_t i = 0; i < results->scene_count; i++)
+    {
+        const struct ResultsFileScene *other = &results->scenes[i];
+        if (strcmp(other->name, scene->name) == 0 && strcmp(other->parameters, scene->parameters) == 0)
+        {
+            return other;
+        }
+    }
+
+    return NULL;
+}
+
+// "key=value;" pairs of the results file reader as parameter records
+static void write_parameters(FILE *file, const char *parameters)
+{
+    while (*parameters != '\0')
+    {
+        size_t key_length = strcspn(parameters, "=");
+        const char *value = parameters + key_length + (parameters[key_length] == '=' ? 1 : 0);
+        size_t value_length = strcspn(value, ";");
+
+        char key[128];
+        snprintf(key, sizeof(key), "%.*s", (int)key_length, parameters);
+        write_parameter_record(file, key, "%.*s", (int)value_length, value);
+
+        parameters = value + value_length + (value[value_length] == ';' ? 1 : 0);
+    }
+}
+
+static const char *find_environment(const struct ResultsFile *results, const char *key)
+{
+    for (size_t i = 0; i < results->environment_count; i++)
+    {
+        if (strcmp(results->environment[i].key, key) == 0)
+        {
+            return results->environment[i].value;
+        }
+    }
+
+    return NULL;
+}
+
+// Whether every copy which wrote results reported the value for the key
+static bool is_shared_environment(const struct ResultsFile *process_results, const bool *read, const char *key, const char *value)
+{
+    for (int i = 0; i < process_count; i++)
+    {
+        const char *other = read[i] ? find_environment(&process_results[i], key) : value;
+        if (!other || strcmp(other, value) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Entries every copy reported the same are written once, the others once per copy
+static void write_environment(FILE *file, const struct ResultsFile *process_results, const bool *read,
+                              const struct ResultsFile *reference)
+{
+    for (size_t e = 0; e < reference->environment_count; e++)
+    {
+        const struct ResultsFileEnvironment *entry = &reference->environment[e];
+        if (is_shared_environment(process_results, read, entry->key, entry->value))
+        {
+            write_environment_record(file, entry->key, entry->value);
+        }
+    }
+
+    for (int i = 0; i < process_count; i++)
+    {
+        for (size_t e = 0; read[i] && e < process_results[i].environment_count; e++)
+        {
+            const struct ResultsFileEnvironment *entry = &process_results[i].environment[e];
+            if (!is_shared_environment(process_results, read, entry->key, entry->value))
+            {
+                char key[128];
+                snprintf(key, sizeof(key), "process%i_%s", i, entry->key);
+                write_environment_record(file, key, entry->value);
+            }
+        }
+    }
+}
+
+static void write_startup_stages(FILE *file, const struct ResultsFile *process_results, const bool *read)
+{
+    for (int i = 0; i < process_count; i++)
+    {
+        for (size_t s = 0; read[i] && s < process_results[i].startup_stage_count; s++)
+        {
+            const struct ResultsFileStartupStage *stage = &process_results[i].startup_stages[s];
+
+            char name[128];
+            snprintf(name, sizeof(name), "process%i %s", i, stage->name);
+            write_startup_record(file, name, stage->duration_ms, stage->finished_ms);
+        }
+    }
+}
+
+static bool report_scene(FILE *file, const struct ResultsFile *process_results, const struct ResultsFileScene *reference)
+{
+    const struct ResultsFileScene *scenes[MAX_PROCESSES];
+    double fps[MAX_PROCESSES];
+    size_t frame_count = 0;
+    int count = 0;
+
+    for (int i = 0; i < process_count; i++)
+    {
+        scenes[i] = find_scene(&process_results[i], reference);
+        fps[i] = NAN;
+        if (scenes[i] && get_results_file_metric(scenes[i], "fps", &fps[i]))
+        {
+            frame_count += scenes[i]->frame_count;
+            count++;
+        }
+        else
+        {
+            scenes[i] = NULL;
+        }
+    }
+
+    // Frames of every copy, the tail is what a user of the busiest one sees
+    double *frame_ms = malloc((frame_count > 0 ? frame_count : 1) * sizeof(double));
+    if (!frame_ms)
+    {
+        print_error("Failed to allocate memory for the harness report\n");
+        return false;
+    }
+
+    print("%s (%i of %i processes)\n", reference->name, count, process_count);
+
+    double aggregate_fps = 0.0;
+    double squared_fps = 0.0;
+    double worst_p99 = 0.0;
+    size_t frame_index = 0;
+    for (int i = 0; i < process_count; i++)
+    {
+        if (!scenes[i])
+        {
+            print("  process %-2i : no results\n", i);
+            continue;
+        }
+
+        memcpy(frame_ms + frame_index, scenes[i]->frame_ms, scenes[i]->frame_count * sizeof(double));
+        frame_index += scenes[i]->frame_count;
+
+        double p50 = get_percentile(scenes[i]->frame_ms, scenes[i]->frame_count, 50.0);
+        double p99 = get_percentile(scenes[i]->frame_ms, scenes[i]->frame_count, 99.0);
+        print("  process %-2i : %8.1f FPS, p50 %7.3f ms, p99 %7.3f ms\n", i, fps[i], p50, p99);
+
+        aggregate_fps += fps[i];
+        squared_fps += fps[i] * fps[i];
+        worst_p99 = fmax(worst_p99, p99);
+    }
+
+    // Jain's index, 1 if every copy got the same frame rate and 1/n if one got everything
+    double fairness = squared_fps > 0.0 ? aggregate_fps * aggregate_fps / (count * squared_fps) : NAN;
+    double p50 = get_percentile(frame_ms, frame_count, 50.0);
+    double p99 = get_percentile(frame_ms, frame_count, 99.0);
+    double p999 = get_percentile(frame_ms, frame_count, 99.9);
+    double max = get_percentile(frame_ms, frame_count, 100.0);
+
+    print("  aggregate  : %8.1f FPS, fairness %.3f\n", aggregate_fps, fairness);
+    print("  all frames : p50 %7.3f ms, p99 %7.3f ms, p99.9 %7.3f ms, max %7.3f ms (worst process p99 %.3f ms)\n",
+          p50, p99, p999, max, worst_p99);
+    print("\n");
+
+    if (file)
+    {
+        write_scene_record(file, reference->name);
+        write_parameters(file, reference->parameters);
+        write_parameter_record(file, "processes", "%i", process_count);
+
+        write_metric_record(file, "processes_reported", "%i", count);
+        write_metric_record(file, "fps", "%f", aggregate_fps);
+        write_metric_record(file, "fairness", "%f", fairness);
+        write_metric_record(file, "frame_p50_ms", "%f", p50);
+        write_metric_record(file, "frame_p99_ms", "%f", p99);
+        write_metric_record(file, "frame_p999_ms", "%f", p999);
+        write_metric_record(file, "frame_max_ms", "%f", max);
+        write_metric_record(file, "worst_process_p99_ms", "%f", worst_p99);
+        for (int i = 0; i < process_count; i++)
+        {
+            if (scenes[i])
+            {
+                write_metric_record(file, process_metric_names[i], "%f", fps[i]);
+            }
+        }
+
+        begin_results_record(file, RESULTS_RECORD_FRAME_COLUMNS);
+        add_results_field(file, "frame_ns");
+        end_results_record(file);
+        for (size_t i = 0; i < frame_count; i++)
+        {
+            begin_results_record(file, RESULTS_RECORD_FRAME);
+            add_results_field(file, "%lld", (long long)llround(frame_ms[i] * 1e6));
+            end_results_record(file);
+        }
+        write_end_record(file);
+    }
+
+    free(frame_ms);
+
+    return true;
+}
+
+static bool report(const struct ResultsFile *process_results, bool *read)
+{
+    // The scenes of the first copy which wrote results are reported
+    const struct ResultsFile *reference = NULL;
+    for (int i = 0; i < process_count && !reference; i++)
+    {
+        reference = read[i] ? &process_results[i] : NULL;
+    }
+
+    if (!reference)
+    {
+        print_error("No process wrote results\n");
+        return false;
+    }
+
+    FILE *file = NULL;
+    if (combined_results_path)
+    {
+        file = fopen(combined_results_path, "w");
+        if (!file)
+        {
+            print_error("Could not open results file '%s'\n", combined_results_path);
+            return false;
+        }
+
+        write_results_header(file);
+        write_environment(file, process_results, read, reference);
+        write_startup_stages(file, process_results, read);
+    }
+
+    print("Harness report\n");
+    print("--------------\n");
+
+    if (reference->scene_count == 0)
+    {
+        print("No scene finished\n\n");
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < reference->scene_count && success; i++)
+    {
+        success = report_scene(file, process_results, &reference->scenes[i]);
+    }
+
+    if (file)
+    {
+        success = !ferror(file) && success;
+        fclose(file);
+
+        if (!success)
+        {
+            print_error("Could not write results file '%s'\n", combined_results_path);
+            return false;
+        }
+
+        print("Results written to '%s'\n", combined_results_path);
+    }
+
+    return success;
+}
+
+bool finish_harness()
+{
+    bool success = wait_for_processes();
+
+    struct ResultsFile process_results[MAX_PROCESSES];
+    bool read[MAX_PROCESSES];
+    for (int i = 0; i < process_count; i++)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/process-%i.txt", directory, i);
+        read[i] = read_results_file(path, &process_results[i]);
+    }
+
+    success = report(process_results, read) && success;
+
+    for (int i = 0; i < process_count; i++)
+    {
+        if (read[i])
+        {
+            free_results_file(&process_results[i]);
+        }
+    }
+
+    // The output of the copies is kept to find out what went wrong
+    if (!success)
+    {
+        print_error("The output of every process is in %s\n", directory);
+        return false;
+    }
+
+    for (int i = 0; i < process_count; i++)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/process-%i.log", directory, i);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/process-%i.txt", directory, i);
+        unlink(path);
+    }
+    rmdir(directory);
+
+    return true;
+}
+
+void cleanup_harness()
+{
+    if (barrier)
+    {
+        munmap(barrier, sizeof(struct Barrier));
+        barrier = NULL;
+    }
+}
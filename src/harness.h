@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+
+// Forks process_count copies of the benchmark which continue as usual, false
+// if they could not be started. Has to run before any thread is created.
+bool start_harness(int process_count);
+// True in the process which started the copies instead of running scenes
+bool is_harness_parent();
+// Waits for the copies and reports on their results, false if one failed
+bool finish_harness();
+void cleanup_harness();
+
+// Blocks until every running copy arrived, does nothing outside the harness
+void synchronize_harness();
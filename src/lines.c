@@ -0,0 +1,543 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "lines.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include "common.h"
+#include "egl.h"
+#include "options.h"
+#include "scenes.h"
+#include "trace.h"
+#include "gl-resources.h"
+
+/*
+ * Lines
+ *
+ * Replaces GL_LINE_STRIP, whose width many drivers clamp to a single pixel,
+ * with triangle strips of a fixed width in pixels. Every segment becomes a
+ * quad; the triangles between the quads of two segments fill the bevel of
+ * the join, or collapse if both quads end at the shared miter point. All
+ * lines are drawn at once, separated by degenerate triangles.
+ *
+ * The CPU mode expands the lines into final positions. The shader mode
+ * hands both ends of the segment and the neighbouring point to the vertex
+ * shader, which does the same computation, trading upload size for CPU time.
+ * Shader antialiasing draws the quads of the shader mode a pixel wider and
+ * derives the coverage from the distance to the line center.
+ */
+
+// Four vertices per segment plus two to separate the lines
+#define VERTICES_PER_LINE(points) (4 * ((points) - 1) + 2)
+
+struct CpuVertex
+{
+    GLfloat position[2];
+};
+
+#ifdef NIGHTMARE_USE_GLES2
+struct ShaderVertex
+{
+    GLfloat start[2];
+    GLfloat end[2];
+    // Point before the start (for the start corners) or after the end of the segment
+    GLfloat neighbor[2];
+    // x: 0 at the start, 1 at the end of the segment; y: side of the line
+    GLfloat corner[2];
+};
+
+static GLchar cpu_vertex_shader_source[] =
+    "attribute vec2 a_position;"
+    "void main()"
+    "{"
+    "gl_Position = vec4(a_position, 0.0, 1.0);"
+    "}";
+
+static GLchar shader_vertex_shader_source[] =
+    "attribute vec2 a_start;"
+    "attribute vec2 a_end;"
+    "attribute vec2 a_neighbor;"
+    "attribute vec2 a_corner;"
+    "uniform mat2 u_transformation;"
+    "uniform vec2 u_half_viewport;"
+    "uniform float u_extent;"
+    "uniform float u_miter;"
+    "varying float v_distance;"
+    "vec2 to_pixels(vec2 coord)"
+    "{"
+    "return u_transformation * coord * u_half_viewport;"
+    "}"
+    "vec2 get_normal(vec2 from, vec2 to)"
+    "{"
+    "vec2 d = to - from;"
+    "d = dot(d, d) > 0.0 ? normalize(d) : vec2(1.0, 0.0);"
+    "return vec2(-d.y, d.x);"
+    "}"
+    "void main()"
+    "{"
+    "vec2 start = to_pixels(a_start);"
+    "vec2 end = to_pixels(a_end);"
+    "vec2 neighbor = to_pixels(a_neighbor);"
+    "vec2 normal = get_normal(start, end);"
+    "vec2 point = a_corner.x > 0.5 ? end : start;"
+    "vec2 offset = normal;"
+    "vec2 adjacent = a_corner.x > 0.5 ? neighbor - end : start - neighbor;"
+    "if (u_miter > 0.5 && dot(adjacent, adjacent) > 0.0)"
+    "{"
+    "vec2 sum = normal + get_normal(vec2(0.0), adjacent);"
+    "if (dot(sum, sum) > 1e-6)"
+    "{"
+    "vec2 miter = normalize(sum);"
+    "offset = miter / max(dot(miter, normal), 0.25);"
+    "}"
+    "}"
+    "v_distance = a_corner.y * u_extent;"
+    "gl_Position = vec4((point + offset * v_distance) / u_half_viewport, 0.0, 1.0);"
+    "}";
+
+static GLchar fragment_shader_source[] =
+    "precision mediump float;"
+    "uniform vec4 u_color;"
+    "void main()"
+    "{"
+    "gl_FragColor = u_color;"
+    "}";
+
+static GLchar antialiased_fragment_shader_source[] =
+    "precision mediump float;"
+    "uniform vec4 u_color;"
+    "uniform float u_half_width;"
+    "varying float v_distance;"
+    "void main()"
+    "{"
+    "float coverage = clamp(u_half_width + 0.5 - abs(v_distance), 0.0, 1.0);"
+    "gl_FragColor = vec4(u_color.rgb, u_color.a * coverage);"
+    "}";
+
+enum
+{
+    A_POSITION = 0,
+    A_START = 0,
+    A_END,
+    A_NEIGHBOR,
+    A_CORNER,
+};
+
+static GLuint shader_program = 0;
+static GLint u_transformation;
+static GLint u_half_viewport;
+static GLint u_extent;
+static GLint u_half_width;
+static GLint u_miter;
+static GLint u_color;
+static struct ShaderVertex *shader_vertices = NULL;
+#endif
+
+static struct CpuVertex *cpu_vertices = NULL;
+static size_t vertices_capacity = 0;
+
+bool use_line_renderer()
+{
+    return options.line_mode != LINE_MODE_STRIP || options.antialiasing == ANTIALIASING_SHADER;
+}
+
+int get_line_damage_margin()
+{
+    float extent = options.line_width / 2.0f;
+    if (options.antialiasing == ANTIALIASING_SHADER)
+    {
+        // The antialiased edge is drawn a pixel further out
+        extent += 1.0f;
+    }
+    if (use_line_renderer() && options.line_join == LINE_JOIN_MITER)
+    {
+        extent *= MITER_LIMIT;
+    }
+
+    // One more pixel for the rasterization of the edges
+    return (int)ceilf(extent) + 1;
+}
+
+#ifdef NIGHTMARE_USE_GLES2
+// Shader antialiasing needs the distance to the line center, which only the shader mode provides
+static bool expands_in_shader()
+{
+    return options.line_mode == LINE_MODE_SHADER || options.antialiasing == ANTIALIASING_SHADER;
+}
+#endif
+
+bool initialize_line_renderer(size_t line_count, size_t point_count)
+{
+    vertices_capacity = line_count * VERTICES_PER_LINE(point_count);
+
+#ifdef NIGHTMARE_USE_GLES2
+    if (expands_in_shader())
+    {
+        const struct AttributeBinding bindings[] = {
+            {A_START, "a_start"},
+            {A_END, "a_end"},
+            {A_NEIGHBOR, "a_neighbor"},
+            {A_CORNER, "a_corner"},
+        };
+
+        const GLchar *fragment_source = options.antialiasing == ANTIALIASING_SHADER ? antialiased_fragment_shader_source
+                                                                                    : fragment_shader_source;
+        if (!build_program(&shader_program, shader_vertex_shader_source, fragment_source, bindings, 4))
+        {
+            print_error("Failed to build GL program for lines\n");
+            shader_program = 0;
+            return false;
+        }
+
+        u_transformation = glGetUniformLocation(shader_program, "u_transformation");
+        u_half_viewport = glGetUniformLocation(shader_program, "u_half_viewport");
+        u_extent = glGetUniformLocation(shader_program, "u_extent");
+        u_half_width = glGetUniformLocation(shader_program, "u_half_width");
+        u_miter = glGetUniformLocation(shader_program, "u_miter");
+
+        shader_vertices = malloc(vertices_capacity * sizeof(struct ShaderVertex));
+        if (!shader_vertices)
+        {
+            print_error("Failed to allocate memory for line vertices\n");
+            cleanup_line_renderer();
+            return false;
+        }
+    }
+    else
+    {
+        const struct AttributeBinding bindings[] = {{A_POSITION, "a_position"}};
+        if (!build_program(&shader_program, cpu_vertex_shader_source, fragment_shader_source, bindings, 1))
+        {
+            print_error("Failed to build GL program for lines\n");
+            shader_program = 0;
+            return false;
+        }
+    }
+
+    u_color = glGetUniformLocation(shader_program, "u_color");
+#endif
+
+    if (options.line_mode == LINE_MODE_CPU && options.antialiasing != ANTIALIASING_SHADER)
+    {
+        cpu_vertices = malloc(vertices_capacity * sizeof(struct CpuVertex));
+        if (!cpu_vertices)
+        {
+            print_error("Failed to allocate memory for line vertices\n");
+            cleanup_line_renderer();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void cleanup_line_renderer()
+{
+#ifdef NIGHTMARE_USE_GLES2
+    if (shader_program)
+    {
+        delete_gl_resource(GL_RESOURCE_PROGRAM, shader_program);
+        shader_program = 0;
+    }
+
+    free(shader_vertices);
+    shader_vertices = NULL;
+#endif
+
+    free(cpu_vertices);
+    cpu_vertices = NULL;
+    vertices_capacity = 0;
+}
+
+static inline void get_point(const void *data, GLenum type, size_t index, GLfloat *point)
+{
+    if (type == GL_FIXED)
+    {
+        const int32_t *values = (const int32_t *)data + index * 2;
+        point[0] = from_fixed(values[0]);
+        point[1] = from_fixed(values[1]);
+    }
+    else
+    {
+        const GLfloat *values = (const GLfloat *)data + index * 2;
+        point[0] = values[0];
+        point[1] = values[1];
+    }
+}
+
+// Unit normal of the direction from a to b (an arbitrary one if both are equal)
+static inline void get_normal(const GLfloat *a, const GLfloat *b, GLfloat *normal)
+{
+    GLfloat dx = b[0] - a[0];
+    GLfloat dy = b[1] - a[1];
+    GLfloat length = sqrtf(dx * dx + dy * dy);
+    if (length > 0.0f)
+    {
+        normal[0] = -dy / length;
+        normal[1] = dx / length;
+    }
+    else
+    {
+        normal[0] = 0.0f;
+        normal[1] = 1.0f;
+    }
+}
+
+// Offset of the corners at a point of the segment with the given normal. The
+// adjacent segment continues the line through the point (NULL if there is none).
+static inline void get_offset(const GLfloat *normal, const GLfloat *adjacent_from, const GLfloat *adjacent_to, GLfloat *offset)
+{
+    offset[0] = normal[0];
+    offset[1] = normal[1];
+
+    if (options.line_join != LINE_JOIN_MITER || !adjacent_from ||
+        (adjacent_from[0] == adjacent_to[0] && adjacent_from[1] == adjacent_to[1]))
+    {
+        return;
+    }
+
+    GLfloat adjacent_normal[2];
+    get_normal(adjacent_from, adjacent_to, adjacent_normal);
+
+    GLfloat sum[2] = {normal[0] + adjacent_normal[0], normal[1] + adjacent_normal[1]};
+    GLfloat length = sqrtf(sum[0] * sum[0] + sum[1] * sum[1]);
+    if (length > 1e-3f)
+    {
+        GLfloat miter[2] = {sum[0] / length, sum[1] / length};
+        GLfloat cosine = fmaxf(miter[0] * normal[0] + miter[1] * normal[1], 1.0f / MITER_LIMIT);
+        offset[0] = miter[0] / cosine;
+        offset[1] = miter[1] / cosine;
+    }
+}
+
+// Expands into positions in normalized device coordinates, returns the vertex count
+static size_t expand_on_cpu(const void *data, GLenum type, size_t line_count, size_t point_count, size_t count,
+                            float z_rotation, float scale)
+{
+    float half_width = options.line_width / 2.0f;
+    float half_viewport[2] = {render_width / 2.0f, render_height / 2.0f};
+    float s = sinf(z_rotation) * scale;
+    float c = cosf(z_rotation) * scale;
+
+    struct CpuVertex *vertex = cpu_vertices;
+    for (size_t li = 0; li < line_count; li++)
+    {
+        // Transform the points of the line into pixels
+        GLfloat previous[2], start[2], end[2], next[2];
+        for (size_t pi = 0; pi + 1 < count; pi++)
+        {
+            if (pi == 0)
+            {
+                GLfloat point[2];
+                get_point(data, type, li * point_count, point);
+                start[0] = (c * point[0] - s * point[1]) * half_viewport[0];
+                start[1] = (s * point[0] + c * point[1]) * half_viewport[1];
+
+                get_point(data, type, li * point_count + 1, point);
+                end[0] = (c * point[0] - s * point[1]) * half_viewport[0];
+                end[1] = (s * point[0] + c * point[1]) * half_viewport[1];
+            }
+            else
+            {
+                previous[0] = start[0];
+                previous[1] = start[1];
+                start[0] = end[0];
+                start[1] = end[1];
+                end[0] = next[0];
+                end[1] = next[1];
+            }
+
+            bool has_next = pi + 2 < count;
+            if (has_next)
+            {
+                GLfloat point[2];
+                get_point(data, type, li * point_count + pi + 2, point);
+                next[0] = (c * point[0] - s * point[1]) * half_viewport[0];
+                next[1] = (s * point[0] + c * point[1]) * half_viewport[1];
+            }
+
+            GLfloat normal[2], start_offset[2], end_offset[2];
+            get_normal(start, end, normal);
+            get_offset(normal, pi > 0 ? previous : NULL, start, start_offset);
+            get_offset(normal, has_next ? end : NULL, next, end_offset);
+
+            struct CpuVertex corners[4];
+            for (int corner = 0; corner < 4; corner++)
+            {
+                const GLfloat *point = corner < 2 ? start : end;
+                const GLfloat *offset = corner < 2 ? start_offset : end_offset;
+                float side = corner % 2 == 0 ? half_width : -half_width;
+
+                corners[corner].position[0] = (point[0] + offset[0] * side) / half_viewport[0];
+                corners[corner].position[1] = (point[1] + offset[1] * side) / half_viewport[1];
+            }
+
+            // Repeating the first vertex of a line starts a new strip
+            if (pi == 0 && li > 0)
+            {
+                (*vertex++) = corners[0];
+            }
+
+            for (int corner = 0; corner < 4; corner++)
+            {
+                (*vertex++) = corners[corner];
+            }
+        }
+
+        // Repeating the last vertex of a line ends its strip
+        if (count >= 2 && li + 1 < line_count)
+        {
+            (*vertex) = (*(vertex - 1));
+            vertex++;
+        }
+    }
+
+    return vertex - cpu_vertices;
+}
+
+#ifdef NIGHTMARE_USE_GLES2
+// Copies the segments into vertices for the shader expansion, returns the vertex count
+static size_t expand_for_shader(const void *data, GLenum type, size_t line_count, size_t point_count, size_t count)
+{
+    struct ShaderVertex *vertex = shader_vertices;
+    for (size_t li = 0; li < line_count; li++)
+    {
+        size_t first = li * point_count;
+
+        for (size_t pi = 0; pi + 1 < count; pi++)
+        {
+            GLfloat start[2], end[2], previous[2], next[2];
+            get_point(data, type, first + pi, start);
+            get_point(data, type, first + pi + 1, end);
+            get_point(data, type, first + (pi > 0 ? pi - 1 : pi), previous);
+            get_point(data, type, first + (pi + 2 < count ? pi + 2 : pi + 1), next);
+
+            // Repeating the first vertex of a line starts a new strip
+            int corners = pi == 0 && li > 0 ? 5 : 4;
+            for (int i = 0; i < corners; i++)
+            {
+                int corner = corners == 5 && i > 0 ? i - 1 : i;
+                bool at_end = corner >= 2;
+
+                vertex->start[0] = start[0];
+                vertex->start[1] = start[1];
+                vertex->end[0] = end[0];
+                vertex->end[1] = end[1];
+                vertex->neighbor[0] = at_end ? next[0] : previous[0];
+                vertex->neighbor[1] = at_end ? next[1] : previous[1];
+                vertex->corner[0] = at_end ? 1.0f : 0.0f;
+                vertex->corner[1] = corner % 2 == 0 ? 1.0f : -1.0f;
+                vertex++;
+            }
+        }
+
+        // Repeating the last vertex of a line ends its strip
+        if (count >= 2 && li + 1 < line_count)
+        {
+            (*vertex) = (*(vertex - 1));
+            vertex++;
+        }
+    }
+
+    return vertex - shader_vertices;
+}
+#endif
+
+void draw_lines(const void *data, GLenum type, size_t line_count, size_t point_count, size_t count,
+                float z_rotation, float scale, const float *color)
+{
+    if (count < 2 || line_count * VERTICES_PER_LINE(count) > vertices_capacity)
+    {
+        return;
+    }
+
+    struct TraceSpan span = trace_begin("expand lines");
+
+#ifdef NIGHTMARE_USE_GLES1
+    size_t vertex_count = expand_on_cpu(data, type, line_count, point_count, count, z_rotation, scale);
+
+    // Scenes keep their buffer bound and their transformation on the matrix stack
+    GLint bound_buffer;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &bound_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glColor4f(color[0], color[1], color[2], color[3]);
+    glVertexPointer(2, GL_FLOAT, 0, cpu_vertices);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, vertex_count);
+    glPopMatrix();
+
+    glBindBuffer(GL_ARRAY_BUFFER, bound_buffer);
+    add_uploaded_bytes(vertex_count * sizeof(struct CpuVertex));
+#elif defined NIGHTMARE_USE_GLES2
+    glUseProgram(shader_program);
+    glUniform4fv(u_color, 1, color);
+
+    // The first attribute array is in use by the scene as well
+    GLint position_enabled;
+    glGetVertexAttribiv(A_POSITION, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &position_enabled);
+    glEnableVertexAttribArray(A_POSITION);
+
+    size_t vertex_count;
+    if (expands_in_shader())
+    {
+        vertex_count = expand_for_shader(data, type, line_count, point_count, count);
+
+        float s = sinf(z_rotation) * scale;
+        float c = cosf(z_rotation) * scale;
+        // column-major order
+        float transformation[4] = {c, s, -s, c};
+        glUniformMatrix2fv(u_transformation, 1, GL_FALSE, transformation);
+        glUniform2f(u_half_viewport, render_width / 2.0f, render_height / 2.0f);
+        glUniform1f(u_half_width, options.line_width / 2.0f);
+        glUniform1f(u_miter, options.line_join == LINE_JOIN_MITER ? 1.0f : 0.0f);
+
+        bool antialiased = options.antialiasing == ANTIALIASING_SHADER;
+        // One additional pixel for the antialiased edge
+        glUniform1f(u_extent, options.line_width / 2.0f + (antialiased ? 1.0f : 0.0f));
+        if (antialiased)
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+
+        GLsizei stride = sizeof(struct ShaderVertex);
+        glEnableVertexAttribArray(A_END);
+        glEnableVertexAttribArray(A_NEIGHBOR);
+        glEnableVertexAttribArray(A_CORNER);
+        glVertexAttribPointer(A_START, 2, GL_FLOAT, GL_FALSE, stride, shader_vertices[0].start);
+        glVertexAttribPointer(A_END, 2, GL_FLOAT, GL_FALSE, stride, shader_vertices[0].end);
+        glVertexAttribPointer(A_NEIGHBOR, 2, GL_FLOAT, GL_FALSE, stride, shader_vertices[0].neighbor);
+        glVertexAttribPointer(A_CORNER, 2, GL_FLOAT, GL_FALSE, stride, shader_vertices[0].corner);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, vertex_count);
+        glDisableVertexAttribArray(A_END);
+        glDisableVertexAttribArray(A_NEIGHBOR);
+        glDisableVertexAttribArray(A_CORNER);
+        if (antialiased)
+        {
+            glDisable(GL_BLEND);
+        }
+
+        add_uploaded_bytes(vertex_count * sizeof(struct ShaderVertex));
+    }
+    else
+    {
+        vertex_count = expand_on_cpu(data, type, line_count, point_count, count, z_rotation, scale);
+
+        glVertexAttribPointer(A_POSITION, 2, GL_FLOAT, GL_FALSE, 0, cpu_vertices);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, vertex_count);
+
+        add_uploaded_bytes(vertex_count * sizeof(struct CpuVertex));
+    }
+
+    if (!position_enabled)
+    {
+        glDisableVertexAttribArray(A_POSITION);
+    }
+#endif
+
+    trace_end(&span);
+}
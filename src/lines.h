@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef NIGHTMARE_USE_GLES1
+#include <GLES/gl.h>
+#elif defined NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+#endif
+
+// Longest miter in half widths before it is cut off (also in the vertex shader)
+#define MITER_LIMIT 4.0f
+
+// Whether the options select lines expanded into triangles instead of GL_LINE_STRIP
+bool use_line_renderer();
+// Pixels the lines drawn with the options reach beyond their points, for damage rectangles
+int get_line_damage_margin();
+
+// Uses the line mode, join and width and the antialiasing of the options
+bool initialize_line_renderer(size_t line_count, size_t point_count);
+void cleanup_line_renderer();
+
+// Draws line_count polylines stored as consecutive x/y pairs (GL_FLOAT or GL_FIXED), point_count apart,
+// of which the first count points are used. The points are scaled, then rotated around the z axis.
+void draw_lines(const void *data, GLenum type, size_t line_count, size_t point_count, size_t count,
+                float z_rotation, float scale, const float *color);
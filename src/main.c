@@ -1,28 +1,66 @@
 // SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
 // SPDX-License-Identifier: MIT
 
-#if !defined(NIGHTMARE_USE_GLES1) && !defined(NIGHTMARE_USE_GLES2)
+#if !defined(NIGHTMARE_USE_GLES1) && !defined(NIGHTMARE_USE_GLES2) && !defined(NIGHTMARE_USE_BACKENDS)
 #error "GL version not selected via a symbol"
 #endif
 
+#include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <strings.h>
 
 #include "signal-handler.h"
-#include "scenes.h"
+#include "event-loop.h"
+#include "harness.h"
+#include "backend.h"
 #include "common.h"
 #include "egl.h"
 #include "random.h"
+#include "data-source.h"
+#include "options.h"
+#include "results.h"
+#include "trace.h"
+#include "perf-counters.h"
+#include "sensors.h"
+#include "startup.h"
 
-#ifdef NIGHTMARE_USE_GLES1
-#include <GLES/gl.h>
-#elif defined NIGHTMARE_USE_GLES2
-#include <GLES2/gl2.h>
-#endif
+// GL_VENDOR, GL_RENDERER and GL_VERSION
+#define GL_STRING_VENDOR 0x1F00
+#define GL_STRING_RENDERER 0x1F01
+#define GL_STRING_VERSION 0x1F02
+
+static const struct Backend *backends[MAX_BACKENDS];
+static size_t backend_count = 0;
+
+static bool load();
+static void print_environment(const struct Backend *backend);
+static bool run_backend_scenes();
+static bool find_scene(const struct Backend *backend, const char *scene_name, size_t *index);
+static bool run_per_backend(bool (*run)(const struct Backend *backend));
+static bool run_config_sweep(const struct Backend *backend);
+static bool run_antialiasing_sweep(const struct Backend *backend);
+static bool run_line_sweep(const struct Backend *backend);
+static bool run_shader_benchmark(const struct Backend *backend);
+static bool run_capacity_search(const struct Backend *backend);
 
-int main()
+int main(int argc, char *argv[])
 {
    int status_code = 1;
 
+   initialize_startup_profile();
+
+   if (!parse_options(argc, argv))
+   {
+      print_usage(argv[0]);
+      return 1;
+   }
+   else if (options.show_help)
+   {
+      print_usage(argv[0]);
+      return 0;
+   }
+
    print("       _       _     _\n");
    print("      (_)     | |   | |\n");
    print(" _ __  _  __ _| |__ | |_ _ __ ___   __ _ _ __ ___\n");
@@ -33,36 +71,345 @@ int main()
    print("         |___/\n");
    print("\n");
 
+   if (!load())
+   {
+      return 1;
+   }
+
+   // The copies continue below, this process only waits for and reports on them
+   if (options.process_count > 1)
+   {
+      if (!start_harness(options.process_count))
+      {
+         goto failure;
+      }
+      else if (is_harness_parent())
+      {
+         status_code = finish_harness() ? 0 : 1;
+         goto failure;
+      }
+   }
+
    // Initialize modules
-   initialize_signal_handler();
+   if (options.trace_path && !initialize_trace(options.trace_path))
+   {
+      print_error("Failed to initialize tracing\n");
+      goto failure;
+   }
+
+   if (!initialize_event_loop() || !initialize_signal_handler())
+   {
+      goto failure;
+   }
    initialize_random();
-   if (!initialize_egl())
+
+   if (options.ingest_name ? !initialize_data_ingestion(options.ingest_name) : !initialize_data_source(options.data_path))
+   {
+      goto failure;
+   }
+   results_set_environment("data", options.data_path ? options.data_path : options.ingest_name ? "ingest" : "random");
+   if (options.ingest_name)
+   {
+      results_set_environment("ingest_ring", options.ingest_name);
+   }
+
+   // The framebuffer configuration has to be usable by every backend
+   for (size_t i = 0; i < backend_count; i++)
+   {
+      egl_renderable_type |= backends[i]->renderable_type;
+   }
+
+   struct TraceSpan egl_span = trace_begin("initialize EGL");
+   bool egl_initialized = initialize_egl(backends[0]->context_version);
+   trace_end(&egl_span);
+
+   if (!egl_initialized)
    {
       print_error("Failed to initialize EGL\n");
       goto failure;
    }
 
    // Print environment info
-   const GLubyte *vendor = glGetString(GL_VENDOR);
-   const GLubyte *renderer = glGetString(GL_RENDERER);
-   const GLubyte *version = glGetString(GL_VERSION);
    print("Environment information\n");
    print("-----------------------\n");
    print("EGL version : %i.%i\n", egl_major, egl_minor);
-   print("GL vendor   : %s\n", vendor);
-   print("GL renderer : %s\n", renderer);
-   print("GL version  : %s\n", version);
+
+   char egl_version[16];
+   snprintf(egl_version, sizeof(egl_version), "%i.%i", egl_major, egl_minor);
+   results_set_environment("egl_version", egl_version);
+
+   for (size_t i = 0; i < backend_count; i++)
+   {
+      if (!egl_make_current(backends[i]->context_version))
+      {
+         goto failure;
+      }
+
+      print_environment(backends[i]);
+   }
+
+   print("EGL config  : 0x%x (RGBA %i/%i/%i/%i, depth %i, stencil %i, samples %i)\n",
+         egl_config_info.id,
+         egl_config_info.red_size, egl_config_info.green_size, egl_config_info.blue_size, egl_config_info.alpha_size,
+         egl_config_info.depth_size, egl_config_info.stencil_size, egl_config_info.samples);
    print("\n");
 
+   if (options.perf_counters && !initialize_perf_counters())
+   {
+      print("Continuing without performance counters\n\n");
+   }
+
+   if (options.sensors && !initialize_sensors(options.sysfs_root, options.sensor_interval_ms))
+   {
+      print("Continuing without sensors\n\n");
+   }
+
    // Run scenes
-   if (!run_scenes())
+   if (options.shader_benchmark)
+   {
+      if (!run_per_backend(run_shader_benchmark))
+      {
+         print_error("Failed to run shader benchmark\n");
+         goto failure;
+      }
+   }
+   else if (options.capacity_search)
+   {
+      if (!run_per_backend(run_capacity_search))
+      {
+         print_error("Failed to run capacity search\n");
+         goto failure;
+      }
+   }
+   else if (options.antialiasing_sweep)
+   {
+      if (!run_per_backend(run_antialiasing_sweep))
+      {
+         print_error("Failed to run antialiasing sweep\n");
+         goto failure;
+      }
+   }
+   else if (options.line_sweep)
+   {
+      if (!run_per_backend(run_line_sweep))
+      {
+         print_error("Failed to run line mode sweep\n");
+         goto failure;
+      }
+   }
+   else if (options.config_sweep)
+   {
+      if (!run_per_backend(run_config_sweep))
+      {
+         print_error("Failed to run configuration sweep\n");
+         goto failure;
+      }
+   }
+   else if (!run_backend_scenes())
    {
       print_error("Failed to run scenes\n");
       goto failure;
    }
 
+   print_startup_profile();
+   results_print_summary();
+
+   if (options.results_path && !results_write(options.results_path))
+   {
+      goto failure;
+   }
+
    status_code = 0;
 failure:
+   cleanup_perf_counters();
+   cleanup_sensors();
+   cleanup_data_source();
+   results_cleanup();
    cleanup_egl();
+   cleanup_signal_handler();
+   cleanup_event_loop();
+   cleanup_trace();
+   cleanup_harness();
+#ifdef NIGHTMARE_USE_BACKENDS
+   unload_backends();
+#endif
    return status_code;
 }
+
+static bool load()
+{
+#ifdef NIGHTMARE_USE_BACKENDS
+   backend_count = load_backends(backends, options.backend_names, options.backend_name_count);
+
+   return backend_count > 0;
+#else
+   for (size_t i = 0; i < options.backend_name_count; i++)
+   {
+      if (strcasecmp(options.backend_names[i], nightmare_backend.name) != 0)
+      {
+         print_error("This executable only contains the %s backend\n", nightmare_backend.name);
+         return false;
+      }
+   }
+
+   backends[0] = &nightmare_backend;
+   backend_count = 1;
+
+   return true;
+#endif
+}
+
+static void print_environment(const struct Backend *backend)
+{
+   const char *vendor = backend->get_string(GL_STRING_VENDOR);
+   const char *renderer = backend->get_string(GL_STRING_RENDERER);
+   const char *version = backend->get_string(GL_STRING_VERSION);
+
+   print("GL vendor   : %s\n", vendor);
+   print("GL renderer : %s\n", renderer);
+   print("GL version  : %s\n", version);
+
+   results_set_environment("gl_vendor", vendor);
+   results_set_environment("gl_renderer", renderer);
+
+   if (backend_count > 1)
+   {
+      char key[32];
+      snprintf(key, sizeof(key), "gl_version_%s", backend->name);
+      results_set_environment(key, version);
+   }
+   else
+   {
+      results_set_environment("gl_version", version);
+   }
+}
+
+// Runs the scenes back to back on every backend they are selected for
+static bool run_backend_scenes()
+{
+   bool success = true;
+   size_t begun = 0;
+   for (; begun < backend_count; begun++)
+   {
+      if (!egl_make_current(backends[begun]->context_version) ||
+          !backends[begun]->initialize() || !backends[begun]->begin_scenes())
+      {
+         print_error("Failed to prepare backend '%s'\n", backends[begun]->name);
+         success = false;
+         break;
+      }
+   }
+
+   // Every scene runs on each backend in turn before the next scene, backends may not provide the same scenes
+   for (size_t b = 0; b < backend_count && success && !sigint_triggered; b++)
+   {
+      for (size_t s = 0; s < backends[b]->get_scene_count() && success && !sigint_triggered; s++)
+      {
+         const char *scene_name = backends[b]->get_scene_name(s);
+
+         size_t index;
+         bool already_run = false;
+         for (size_t i = 0; i < b && !already_run; i++)
+         {
+            already_run = find_scene(backends[i], scene_name, &index);
+         }
+
+         for (size_t i = b; i < backend_count && !already_run && !sigint_triggered; i++)
+         {
+            if (!find_scene(backends[i], scene_name, &index) || !is_scene_selected(scene_name, backends[i]->name))
+            {
+               continue;
+            }
+
+            if (!egl_make_current(backends[i]->context_version) || !backends[i]->run_scene(index))
+            {
+               success = false;
+               break;
+            }
+         }
+      }
+   }
+
+   for (size_t i = 0; i < begun; i++)
+   {
+      if (egl_make_current(backends[i]->context_version))
+      {
+         backends[i]->end_scenes();
+         backends[i]->cleanup();
+      }
+   }
+
+   return success;
+}
+
+static bool find_scene(const struct Backend *backend, const char *scene_name, size_t *index)
+{
+   for (size_t s = 0; s < backend->get_scene_count(); s++)
+   {
+      if (strcmp(backend->get_scene_name(s), scene_name) == 0)
+      {
+         (*index) = s;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+// Runs one backend after the other, as sweeps replace the surface and with it every context
+static bool run_per_backend(bool (*run)(const struct Backend *backend))
+{
+   for (size_t i = 0; i < backend_count && !sigint_triggered; i++)
+   {
+      if (!egl_make_current(backends[i]->context_version) || !backends[i]->initialize())
+      {
+         return false;
+      }
+
+      bool success = run(backends[i]);
+
+      if (egl_make_current(backends[i]->context_version))
+      {
+         backends[i]->cleanup();
+      }
+
+      if (!success)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool run_config_sweep(const struct Backend *backend)
+{
+   return backend->run_config_sweep();
+}
+
+static bool run_antialiasing_sweep(const struct Backend *backend)
+{
+   return backend->run_antialiasing_sweep();
+}
+
+static bool run_line_sweep(const struct Backend *backend)
+{
+   return backend->run_line_sweep();
+}
+
+static bool run_shader_benchmark(const struct Backend *backend)
+{
+   // Fixed function GLES has no shaders
+   if (backend_count > 1 && backend->context_version < 2)
+   {
+      print("Skipping shader benchmark on backend '%s'\n\n", backend->name);
+      return true;
+   }
+
+   return backend->run_shader_benchmark();
+}
+
+static bool run_capacity_search(const struct Backend *backend)
+{
+   return backend->run_capacity_search();
+}
@@ -0,0 +1,581 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "options.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "common.h"
+
+struct Options options = {
+    .show_help = false,
+    .partial_update = false,
+    .color_format = COLOR_FORMAT_RGBA8888,
+    .config_id = 0,
+    .config_sweep = false,
+    .render_scale = 1.0f,
+    .antialiasing = ANTIALIASING_NONE,
+    .antialiasing_sweep = false,
+    .line_mode = LINE_MODE_STRIP,
+    .line_join = LINE_JOIN_MITER,
+    .line_width = 2.0f,
+    .line_sweep = false,
+    .decimation = DECIMATION_NONE,
+    .decimation_check = false,
+    .trace_path = NULL,
+    .perf_counters = false,
+    .results_path = NULL,
+    .program_cache_path = NULL,
+    .shader_benchmark = false,
+    .offscreen_width = 0,
+    .offscreen_height = 0,
+    .frame_count = 0,
+    .surface_count = 1,
+    .process_count = 1,
+    .on_demand = false,
+    .max_fps = 0.0f,
+    .animation = true,
+    .verify_output = false,
+    .capacity_search = false,
+    .target_fps = 60.0f,
+    .capacity_points = 0,
+    .data_path = NULL,
+    .ingest_name = NULL,
+    .load_lines = 0,
+    .load_points = 0,
+    .sensors = false,
+    .sysfs_root = "/sys",
+    .sensor_interval_ms = 100,
+    .backend_name_count = 0,
+    .scene_filter_count = 0,
+};
+
+enum
+{
+    OPTION_PARTIAL_UPDATE = 256,
+    OPTION_COLOR_FORMAT,
+    OPTION_CONFIG_ID,
+    OPTION_CONFIG_SWEEP,
+    OPTION_RENDER_SCALE,
+    OPTION_ANTIALIASING,
+    OPTION_ANTIALIASING_SWEEP,
+    OPTION_LINES,
+    OPTION_LINE_JOIN,
+    OPTION_LINE_WIDTH,
+    OPTION_LINE_SWEEP,
+    OPTION_DECIMATION,
+    OPTION_DECIMATION_CHECK,
+    OPTION_TRACE,
+    OPTION_PERF_COUNTERS,
+    OPTION_RESULTS,
+    OPTION_PROGRAM_CACHE,
+    OPTION_SHADER_BENCHMARK,
+    OPTION_OFFSCREEN,
+    OPTION_FRAMES,
+    OPTION_ON_DEMAND,
+    OPTION_MIRROR_SURFACES,
+    OPTION_PROCESSES,
+    OPTION_MAX_FPS,
+    OPTION_NO_ANIMATION,
+    OPTION_VERIFY_OUTPUT,
+    OPTION_BACKEND,
+    OPTION_CAPACITY_SEARCH,
+    OPTION_TARGET_FPS,
+    OPTION_CAPACITY_POINTS,
+    OPTION_DATA,
+    OPTION_INGEST,
+    OPTION_LOAD,
+    OPTION_SENSORS,
+    OPTION_SYSFS_ROOT,
+    OPTION_SENSOR_INTERVAL,
+};
+
+static const char *const antialiasing_names[ANTIALIASING_COUNT] = {
+    [ANTIALIASING_NONE] = "none",
+    [ANTIALIASING_MSAA2] = "msaa2",
+    [ANTIALIASING_MSAA4] = "msaa4",
+    [ANTIALIASING_SHADER] = "shader",
+};
+
+static const char *const line_mode_names[LINE_MODE_COUNT] = {
+    [LINE_MODE_STRIP] = "strip",
+    [LINE_MODE_CPU] = "cpu",
+    [LINE_MODE_SHADER] = "shader",
+};
+
+static const char *const line_join_names[LINE_JOIN_COUNT] = {
+    [LINE_JOIN_MITER] = "miter",
+    [LINE_JOIN_BEVEL] = "bevel",
+};
+
+static const char *const decimation_names[DECIMATION_COUNT] = {
+    [DECIMATION_NONE] = "none",
+    [DECIMATION_MIN_MAX] = "minmax",
+    [DECIMATION_LTTB] = "lttb",
+};
+
+static const struct option long_options[] = {
+    {"help", no_argument, NULL, 'h'},
+    {"scene", required_argument, NULL, 's'},
+    {"partial-update", no_argument, NULL, OPTION_PARTIAL_UPDATE},
+    {"color-format", required_argument, NULL, OPTION_COLOR_FORMAT},
+    {"config-id", required_argument, NULL, OPTION_CONFIG_ID},
+    {"config-sweep", no_argument, NULL, OPTION_CONFIG_SWEEP},
+    {"render-scale", required_argument, NULL, OPTION_RENDER_SCALE},
+    {"antialiasing", required_argument, NULL, OPTION_ANTIALIASING},
+    {"antialiasing-sweep", no_argument, NULL, OPTION_ANTIALIASING_SWEEP},
+    {"lines", required_argument, NULL, OPTION_LINES},
+    {"line-join", required_argument, NULL, OPTION_LINE_JOIN},
+    {"line-width", required_argument, NULL, OPTION_LINE_WIDTH},
+    {"line-sweep", no_argument, NULL, OPTION_LINE_SWEEP},
+    {"decimation", required_argument, NULL, OPTION_DECIMATION},
+    {"decimation-check", no_argument, NULL, OPTION_DECIMATION_CHECK},
+    {"trace", required_argument, NULL, OPTION_TRACE},
+    {"perf-counters", no_argument, NULL, OPTION_PERF_COUNTERS},
+    {"results", required_argument, NULL, OPTION_RESULTS},
+    {"program-cache", required_argument, NULL, OPTION_PROGRAM_CACHE},
+    {"shader-benchmark", no_argument, NULL, OPTION_SHADER_BENCHMARK},
+    {"offscreen", required_argument, NULL, OPTION_OFFSCREEN},
+    {"frames", required_argument, NULL, OPTION_FRAMES},
+    {"on-demand", no_argument, NULL, OPTION_ON_DEMAND},
+    {"mirror-surfaces", required_argument, NULL, OPTION_MIRROR_SURFACES},
+    {"processes", required_argument, NULL, OPTION_PROCESSES},
+    {"max-fps", required_argument, NULL, OPTION_MAX_FPS},
+    {"no-animation", no_argument, NULL, OPTION_NO_ANIMATION},
+    {"verify-output", no_argument, NULL, OPTION_VERIFY_OUTPUT},
+    {"backend", required_argument, NULL, OPTION_BACKEND},
+    {"capacity-search", no_argument, NULL, OPTION_CAPACITY_SEARCH},
+    {"target-fps", required_argument, NULL, OPTION_TARGET_FPS},
+    {"capacity-points", required_argument, NULL, OPTION_CAPACITY_POINTS},
+    {"data", required_argument, NULL, OPTION_DATA},
+    {"ingest", required_argument, NULL, OPTION_INGEST},
+    {"load", required_argument, NULL, OPTION_LOAD},
+    {"sensors", no_argument, NULL, OPTION_SENSORS},
+    {"sysfs-root", required_argument, NULL, OPTION_SYSFS_ROOT},
+    {"sensor-interval", required_argument, NULL, OPTION_SENSOR_INTERVAL},
+    {NULL, 0, NULL, 0},
+};
+
+static bool parse_int(const char *text, int *value)
+{
+    char *end;
+    long result = strtol(text, &end, 0);
+
+    if (*text == '\0' || *end != '\0')
+    {
+        return false;
+    }
+
+    (*value) = (int)result;
+
+    return true;
+}
+
+static bool parse_float(const char *text, float *value)
+{
+    char *end;
+    float result = strtof(text, &end);
+
+    if (*text == '\0' || *end != '\0')
+    {
+        return false;
+    }
+
+    (*value) = result;
+
+    return true;
+}
+
+// Index of the name which matches the value ignoring case, -1 if none does
+static int parse_enum_name(const char *const *names, int count, const char *value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcasecmp(value, names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool parse_options(int argc, char *argv[])
+{
+    int option;
+    while ((option = getopt_long(argc, argv, "hs:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            options.show_help = true;
+            break;
+        case 's':
+            if (options.scene_filter_count >= MAX_SCENE_FILTERS)
+            {
+                print_error("At most %i scenes can be selected\n", MAX_SCENE_FILTERS);
+                return false;
+            }
+            options.scene_filters[options.scene_filter_count++] = optarg;
+            break;
+        case OPTION_PARTIAL_UPDATE:
+            options.partial_update = true;
+            break;
+        case OPTION_COLOR_FORMAT:
+            if (strcasecmp(optarg, "rgba8888") == 0)
+            {
+                options.color_format = COLOR_FORMAT_RGBA8888;
+            }
+            else if (strcasecmp(optarg, "rgb565") == 0)
+            {
+                options.color_format = COLOR_FORMAT_RGB565;
+            }
+            else
+            {
+                print_error("Unknown color format '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_CONFIG_ID:
+            if (!parse_int(optarg, &options.config_id) || options.config_id <= 0)
+            {
+                print_error("Invalid framebuffer configuration id '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_CONFIG_SWEEP:
+            options.config_sweep = true;
+            break;
+        case OPTION_RENDER_SCALE:
+            if (!parse_float(optarg, &options.render_scale) || options.render_scale <= 0.0f || options.render_scale > 1.0f)
+            {
+                print_error("Invalid render scale '%s', expected a value in (0, 1]\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_ANTIALIASING:
+        {
+            int index = parse_enum_name(antialiasing_names, ANTIALIASING_COUNT, optarg);
+            if (index < 0)
+            {
+                print_error("Unknown antialiasing mode '%s'\n", optarg);
+                return false;
+            }
+            options.antialiasing = (enum Antialiasing)index;
+            break;
+        }
+        case OPTION_ANTIALIASING_SWEEP:
+            options.antialiasing_sweep = true;
+            break;
+        case OPTION_LINES:
+        {
+            int index = parse_enum_name(line_mode_names, LINE_MODE_COUNT, optarg);
+            if (index < 0)
+            {
+                print_error("Unknown line mode '%s'\n", optarg);
+                return false;
+            }
+            options.line_mode = (enum LineMode)index;
+            break;
+        }
+        case OPTION_LINE_JOIN:
+        {
+            int index = parse_enum_name(line_join_names, LINE_JOIN_COUNT, optarg);
+            if (index < 0)
+            {
+                print_error("Unknown line join '%s'\n", optarg);
+                return false;
+            }
+            options.line_join = (enum LineJoin)index;
+            break;
+        }
+        case OPTION_LINE_WIDTH:
+            if (!parse_float(optarg, &options.line_width) || options.line_width <= 0.0f)
+            {
+                print_error("Invalid line width '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_LINE_SWEEP:
+            options.line_sweep = true;
+            break;
+        case OPTION_DECIMATION:
+        {
+            int index = parse_enum_name(decimation_names, DECIMATION_COUNT, optarg);
+            if (index < 0)
+            {
+                print_error("Unknown decimation '%s'\n", optarg);
+                return false;
+            }
+            options.decimation = (enum Decimation)index;
+            break;
+        }
+        case OPTION_DECIMATION_CHECK:
+            options.decimation_check = true;
+            break;
+        case OPTION_TRACE:
+            options.trace_path = optarg;
+            break;
+        case OPTION_PERF_COUNTERS:
+            options.perf_counters = true;
+            break;
+        case OPTION_RESULTS:
+            options.results_path = optarg;
+            break;
+        case OPTION_PROGRAM_CACHE:
+            options.program_cache_path = optarg;
+            break;
+        case OPTION_SHADER_BENCHMARK:
+            options.shader_benchmark = true;
+            break;
+        case OPTION_OFFSCREEN:
+        {
+            char trailing;
+            if (sscanf(optarg, "%ix%i%c", &options.offscreen_width, &options.offscreen_height, &trailing) != 2 ||
+                options.offscreen_width <= 0 || options.offscreen_height <= 0)
+            {
+                print_error("Invalid offscreen size '%s', expected WIDTHxHEIGHT\n", optarg);
+                return false;
+            }
+            break;
+        }
+        case OPTION_FRAMES:
+            if (!parse_int(optarg, &options.frame_count) || options.frame_count <= 0)
+            {
+                print_error("Invalid frame count '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_ON_DEMAND:
+            options.on_demand = true;
+            break;
+        case OPTION_MIRROR_SURFACES:
+            if (!parse_int(optarg, &options.surface_count) || options.surface_count < 1 || options.surface_count > MAX_SURFACES)
+            {
+                print_error("Invalid surface count '%s', between 1 and %i surfaces are supported\n", optarg, MAX_SURFACES);
+                return false;
+            }
+            break;
+        case OPTION_PROCESSES:
+            if (!parse_int(optarg, &options.process_count) || options.process_count < 1 || options.process_count > MAX_PROCESSES)
+            {
+                print_error("Invalid process count '%s', between 1 and %i processes are supported\n", optarg, MAX_PROCESSES);
+                return false;
+            }
+            break;
+        case OPTION_MAX_FPS:
+            if (!parse_float(optarg, &options.max_fps) || options.max_fps <= 0.0f)
+            {
+                print_error("Invalid frame rate limit '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_NO_ANIMATION:
+            options.animation = false;
+            break;
+        case OPTION_VERIFY_OUTPUT:
+            options.verify_output = true;
+            break;
+        case OPTION_BACKEND:
+            if (options.backend_name_count >= MAX_BACKEND_NAMES)
+            {
+                print_error("At most %i backends can be selected\n", MAX_BACKEND_NAMES);
+                return false;
+            }
+            options.backend_names[options.backend_name_count++] = optarg;
+            break;
+        case OPTION_CAPACITY_SEARCH:
+            options.capacity_search = true;
+            break;
+        case OPTION_TARGET_FPS:
+            if (!parse_float(optarg, &options.target_fps) || options.target_fps <= 0.0f)
+            {
+                print_error("Invalid target frame rate '%s'\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_CAPACITY_POINTS:
+            if (!parse_int(optarg, &options.capacity_points) || options.capacity_points < 2)
+            {
+                print_error("Invalid point count '%s', at least 2 points are required\n", optarg);
+                return false;
+            }
+            break;
+        case OPTION_DATA:
+            options.data_path = optarg;
+            break;
+        case OPTION_INGEST:
+            options.ingest_name = optarg;
+            break;
+        case OPTION_LOAD:
+        {
+            char trailing;
+            if (sscanf(optarg, "%ix%i%c", &options.load_lines, &options.load_points, &trailing) != 2 ||
+                options.load_lines <= 0 || options.load_points < 2)
+            {
+                print_error("Invalid load '%s', expected LINESxPOINTS with at least 2 points\n", optarg);
+                return false;
+            }
+            break;
+        }
+        case OPTION_SENSORS:
+            options.sensors = true;
+            break;
+        case OPTION_SYSFS_ROOT:
+            options.sysfs_root = optarg;
+            break;
+        case OPTION_SENSOR_INTERVAL:
+            if (!parse_int(optarg, &options.sensor_interval_ms) || options.sensor_interval_ms <= 0)
+            {
+                print_error("Invalid sensor interval '%s'\n", optarg);
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (optind < argc)
+    {
+        print_error("Unexpected argument '%s'\n", argv[optind]);
+        return false;
+    }
+
+    // The damage history describes a single back buffer
+    if (options.partial_update && options.surface_count > 1)
+    {
+        print_error("Partial updates are not supported with mirrored surfaces\n");
+        return false;
+    }
+
+    if (options.data_path && options.ingest_name)
+    {
+        print_error("Samples are either replayed or ingested, not both\n");
+        return false;
+    }
+
+    if (options.decimation_check && options.decimation == DECIMATION_NONE)
+    {
+        print_error("Checking the decimation requires a decimation\n");
+        return false;
+    }
+
+    if (options.process_count > 1)
+    {
+        // Windows of several processes would cover each other
+        if (options.offscreen_width == 0)
+        {
+            print_error("Several processes require an offscreen surface\n");
+            return false;
+        }
+
+        // Every process would write the same trace and consume the same ring
+        if (options.trace_path || options.ingest_name)
+        {
+            print_error("Tracing and ingestion are not supported with several processes\n");
+            return false;
+        }
+    }
+
+    // The back buffer of a window is undefined after presenting, an offscreen surface keeps its content
+    if (options.verify_output && options.offscreen_width == 0)
+    {
+        print_error("Verifying the output requires an offscreen surface\n");
+        return false;
+    }
+
+    return true;
+}
+
+void print_usage(const char *program_name)
+{
+    print("Usage: %s [options]\n", program_name);
+    print("\n");
+    print("Options:\n");
+    print("  -h, --help            Show this help\n");
+    print("  -s, --scene NAME[@B]  Only run scenes whose name starts with NAME, optionally only on backend B (repeatable)\n");
+    print("  --partial-update      Only redraw damaged regions (EGL_EXT_buffer_age)\n");
+    print("  --color-format FMT    Requested framebuffer format: rgba8888 (default) or rgb565\n");
+    print("  --config-id ID        Use the EGL framebuffer configuration with the given id\n");
+    print("  --config-sweep        Run the scenes once per matching framebuffer configuration\n");
+    print("  --render-scale F      Render offscreen at F times the screen resolution and upscale (GLES2)\n");
+    print("  --antialiasing MODE   Line antialiasing: none (default), msaa2, msaa4 or shader (GLES2)\n");
+    print("  --antialiasing-sweep  Run the scenes once per antialiasing mode\n");
+    print("  --lines MODE          Line geometry: strip (GL_LINE_STRIP, default), cpu or shader (GLES2) expanded triangles\n");
+    print("  --line-join JOIN      Joins of expanded lines: miter (default) or bevel\n");
+    print("  --line-width PX       Line width in pixels (default 2)\n");
+    print("  --line-sweep          Run the scenes once per line mode\n");
+    print("  --decimation MODE     Reduce graph lines longer than the pixel columns: none (default), minmax or lttb\n");
+    print("  --decimation-check    Report how many pixels the decimated frame differs from the undecimated one\n");
+    print("  --trace FILE          Write a Chrome trace event JSON of the run to FILE\n");
+    print("  --perf-counters       Sample CPU performance counters around update and draw\n");
+    print("  --results FILE        Write the results including every frame to FILE\n");
+    print("  --program-cache DIR   Cache linked program binaries in DIR (GLES2, GL_OES_get_program_binary)\n");
+    print("  --shader-benchmark    Measure compile, link and first draw times of generated shaders (GLES2)\n");
+    print("  --offscreen WxH       Render to an offscreen surface of the given size instead of a window\n");
+    print("  --frames N            Render N frames per scene instead of running each for 15 seconds\n");
+    print("  --on-demand           Only draw frames in which the scene changed and sleep in between\n");
+    print("  --mirror-surfaces N   Repeat the draw of every frame onto N windows or offscreen surfaces, with one scene state\n");
+    print("  --processes N         Run N copies at once with aligned scene starts and report on them (requires --offscreen)\n");
+    print("  --max-fps FPS         Start frames at most FPS times per second and block in between\n");
+    print("  --no-animation        Neither scale nor rotate the graph scenes\n");
+    print("  --verify-output       Fail scenes whose last frame is blank (requires --offscreen)\n");
+    print("  --backend NAME        Load backend gles1 or gles2 (repeatable, combined executable only)\n");
+    print("  --capacity-search     Find the most lines each scene draws with a p99 frame time within the target\n");
+    print("  --target-fps F        Frame rate the capacity search targets (default 60)\n");
+    print("  --capacity-points N   Points per line during the capacity search (default: scene default)\n");
+    print("  --data FILE           Replay the samples of a series file instead of random samples\n");
+    print("  --ingest NAME         Add the samples another process writes to the shared memory ring NAME\n");
+    print("  --load LxP            Draw L lines of P points in every scene with an adjustable load\n");
+    print("  --sensors             Sample CPU frequency, temperature and throttling while scenes run\n");
+    print("  --sysfs-root DIR      Read the sensors below DIR instead of /sys\n");
+    print("  --sensor-interval MS  Time between sensor samples (default 100)\n");
+}
+
+// Filters are scene name prefixes, optionally limited to a backend with "@BACKEND"
+bool is_scene_selected(const char *scene_name, const char *backend_name)
+{
+    if (options.scene_filter_count == 0)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < options.scene_filter_count; i++)
+    {
+        const char *filter = options.scene_filters[i];
+        const char *backend = strchr(filter, '@');
+        size_t prefix_length = backend ? (size_t)(backend - filter) : strlen(filter);
+
+        if (strncasecmp(scene_name, filter, prefix_length) == 0 &&
+            (!backend || strcasecmp(backend + 1, backend_name) == 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char *get_antialiasing_name(enum Antialiasing antialiasing)
+{
+    return antialiasing_names[antialiasing];
+}
+
+const char *get_line_mode_name(enum LineMode line_mode)
+{
+    return line_mode_names[line_mode];
+}
+
+const char *get_line_join_name(enum LineJoin line_join)
+{
+    return line_join_names[line_join];
+}
+
+const char *get_decimation_name(enum Decimation decimation)
+{
+    return decimation_names[decimation];
+}
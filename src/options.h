@@ -0,0 +1,136 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MAX_SCENE_FILTERS 16
+#define MAX_BACKEND_NAMES 2
+#define MAX_SURFACES 8
+#define MAX_PROCESSES 16
+
+enum ColorFormat
+{
+    COLOR_FORMAT_RGBA8888,
+    COLOR_FORMAT_RGB565,
+};
+
+enum Antialiasing
+{
+    ANTIALIASING_NONE,
+    ANTIALIASING_MSAA2,
+    ANTIALIASING_MSAA4,
+    // Triangle strip expanded lines with analytic coverage in the fragment shader
+    ANTIALIASING_SHADER,
+    ANTIALIASING_COUNT,
+};
+
+enum LineMode
+{
+    // GL_LINE_STRIP with glLineWidth
+    LINE_MODE_STRIP,
+    // Triangle strips expanded on the CPU
+    LINE_MODE_CPU,
+    // Triangle strips expanded in the vertex shader
+    LINE_MODE_SHADER,
+    LINE_MODE_COUNT,
+};
+
+enum LineJoin
+{
+    LINE_JOIN_MITER,
+    LINE_JOIN_BEVEL,
+    LINE_JOIN_COUNT,
+};
+
+enum Decimation
+{
+    DECIMATION_NONE,
+    // Minimum and maximum of the samples per pixel column
+    DECIMATION_MIN_MAX,
+    // Largest triangle three buckets, one sample per pixel column
+    DECIMATION_LTTB,
+    DECIMATION_COUNT,
+};
+
+struct Options
+{
+    bool show_help;
+    bool partial_update;
+    enum ColorFormat color_format;
+    // Explicitly requested framebuffer configuration (0 if not set)
+    int config_id;
+    bool config_sweep;
+    // Fraction of the screen resolution scenes are rendered at (1.0 renders directly)
+    float render_scale;
+    enum Antialiasing antialiasing;
+    bool antialiasing_sweep;
+    enum LineMode line_mode;
+    enum LineJoin line_join;
+    // In pixels of the render target
+    float line_width;
+    bool line_sweep;
+    // Reduction of the graph lines to about the pixel columns they span
+    enum Decimation decimation;
+    // Compare the last decimated frame of every scene with the same frame drawn from every sample
+    bool decimation_check;
+    // Chrome trace event JSON output (NULL if tracing is disabled)
+    const char *trace_path;
+    bool perf_counters;
+    // Structured results output (NULL if not written)
+    const char *results_path;
+    // Program binary cache directory (NULL if disabled)
+    const char *program_cache_path;
+    // Measure shader compile, link and first draw times instead of running scenes
+    bool shader_benchmark;
+    // Size of the offscreen surface rendered to instead of a window (0 if windowed)
+    int offscreen_width;
+    int offscreen_height;
+    // Frames rendered per scene (0 runs every scene for a fixed duration)
+    int frame_count;
+    // Windows or offscreen surfaces the draw of every frame is repeated onto, one after another
+    int surface_count;
+    // Copies of the benchmark run at the same time, each on its own offscreen surface
+    int process_count;
+    // Only draw when the scene changed and sleep until it changes next
+    bool on_demand;
+    // Frames are started at most this often (0 does not limit the frame rate)
+    float max_fps;
+    // Scale and rotate the graph scenes (otherwise only new samples change them)
+    bool animation;
+    // Fail scenes whose last frame is blank (offscreen only)
+    bool verify_output;
+    // Search the largest load each scene sustains at the target frame rate
+    bool capacity_search;
+    float target_fps;
+    // Points per line during the capacity search (0 keeps the scene default)
+    int capacity_points;
+    // Series file the graph scenes replay instead of random samples (NULL if not given)
+    const char *data_path;
+    // Shared memory ring another process writes the samples to (NULL if not given)
+    const char *ingest_name;
+    // Lines and points per line of every scene with an adjustable load (0 keeps the scene default)
+    int load_lines;
+    int load_points;
+    // Sample CPU frequencies, thermal zones and devfreq devices below sysfs_root while scenes run
+    bool sensors;
+    const char *sysfs_root;
+    int sensor_interval_ms;
+    // Backends loaded by the combined executable (all if none are given)
+    const char *backend_names[MAX_BACKEND_NAMES];
+    size_t backend_name_count;
+    const char *scene_filters[MAX_SCENE_FILTERS];
+    size_t scene_filter_count;
+};
+
+extern struct Options options;
+
+bool parse_options(int argc, char *argv[]);
+void print_usage(const char *program_name);
+bool is_scene_selected(const char *scene_name, const char *backend_name);
+const char *get_antialiasing_name(enum Antialiasing antialiasing);
+const char *get_line_mode_name(enum LineMode line_mode);
+const char *get_line_join_name(enum LineJoin line_join);
+const char *get_decimation_name(enum Decimation decimation);
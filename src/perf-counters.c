@@ -0,0 +1,167 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "perf-counters.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "common.h"
+
+/*
+ * Hardware performance counters
+ *
+ * All available counters are opened as one perf event group for the calling
+ * thread, so a single read() returns consistent values for every counter.
+ * Counters which can not be opened (missing PMU, perf_event_paranoid,
+ * virtualization) are skipped.
+ */
+
+struct CounterDefinition
+{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+static const struct CounterDefinition definitions[PERF_COUNTER_COUNT] = {
+    [PERF_COUNTER_CYCLES] = {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_COUNTER_INSTRUCTIONS] = {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_COUNTER_CACHE_REFERENCES] = {"cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    [PERF_COUNTER_CACHE_MISSES] = {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    [PERF_COUNTER_CONTEXT_SWITCHES] = {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+static int group_fd = -1;
+static int fds[PERF_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+// Position of the counter in the group read, -1 if unavailable
+static int positions[PERF_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+static int opened_count = 0;
+
+static int perf_event_open(struct perf_event_attr *attributes, pid_t pid, int cpu, int group, unsigned long flags)
+{
+    return (int)syscall(SYS_perf_event_open, attributes, pid, cpu, group, flags);
+}
+
+bool initialize_perf_counters()
+{
+    opened_count = 0;
+    group_fd = -1;
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        fds[i] = -1;
+        positions[i] = -1;
+
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = definitions[i].type;
+        attributes.config = definitions[i].config;
+        attributes.disabled = group_fd == -1 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+
+        // Calling thread on any CPU
+        int fd = perf_event_open(&attributes, 0, -1, group_fd, 0);
+        if (fd == -1)
+        {
+            print_error("Performance counter '%s' is not available\n", definitions[i].name);
+            continue;
+        }
+
+        if (group_fd == -1)
+        {
+            group_fd = fd;
+        }
+
+        fds[i] = fd;
+        positions[i] = opened_count++;
+    }
+
+    if (group_fd == -1)
+    {
+        print_error("No performance counters available\n");
+        return false;
+    }
+
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+}
+
+void cleanup_perf_counters()
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (fds[i] != -1 && fds[i] != group_fd)
+        {
+            close(fds[i]);
+        }
+
+        fds[i] = -1;
+        positions[i] = -1;
+    }
+
+    if (group_fd != -1)
+    {
+        close(group_fd);
+        group_fd = -1;
+    }
+
+    opened_count = 0;
+}
+
+bool is_perf_counter_available(enum PerfCounter counter)
+{
+    return positions[counter] != -1;
+}
+
+uint32_t get_perf_counter_mask()
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        if (positions[i] != -1)
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+const char *get_perf_counter_name(enum PerfCounter counter)
+{
+    return definitions[counter].name;
+}
+
+bool read_perf_counters(struct PerfCounterValues *values)
+{
+    // Group read format: number of counters followed by their values
+    uint64_t buffer[1 + PERF_COUNTER_COUNT];
+
+    if (group_fd == -1 || read(group_fd, buffer, sizeof(buffer)) < (ssize_t)(sizeof(uint64_t) * (1 + opened_count)))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        values->values[i] = positions[i] != -1 ? buffer[1 + positions[i]] : 0;
+    }
+
+    return true;
+}
+
+void subtract_perf_counters(const struct PerfCounterValues *after, const struct PerfCounterValues *before, struct PerfCounterValues *delta)
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    {
+        delta->values[i] = after->values[i] - before->values[i];
+    }
+}
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum PerfCounter
+{
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CACHE_REFERENCES,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_CONTEXT_SWITCHES,
+    PERF_COUNTER_COUNT,
+};
+
+struct PerfCounterValues
+{
+    uint64_t values[PERF_COUNTER_COUNT];
+};
+
+bool initialize_perf_counters();
+void cleanup_perf_counters();
+
+bool is_perf_counter_available(enum PerfCounter counter);
+// Bit per available counter, 0 if counters are not initialized
+uint32_t get_perf_counter_mask();
+const char *get_perf_counter_name(enum PerfCounter counter);
+
+// Reads the current totals of all counters of the calling thread
+bool read_perf_counters(struct PerfCounterValues *values);
+void subtract_perf_counters(const struct PerfCounterValues *after, const struct PerfCounterValues *before, struct PerfCounterValues *delta);
@@ -0,0 +1,240 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "shm-ring.h"
+
+/*
+ * Sample producer
+ *
+ * Stands in for the process which delivers the graph data in production. It
+ * creates a shared memory ring and publishes a sine wave per channel at a
+ * fixed rate, optionally in bursts of several samples at once, until the
+ * duration passed or it is interrupted. nightmare consumes the samples with
+ * --ingest.
+ */
+
+#define PI 3.14159265358979323846
+#define SEC_IN_NS 1000000000ll
+
+struct ProducerOptions
+{
+    const char *name;
+    int channels;
+    // Samples per second and samples published at once
+    double rate;
+    int burst;
+    int capacity;
+    // Seconds to run (0 runs until interrupted)
+    double duration;
+};
+
+static struct ProducerOptions producer_options = {
+    .name = "/nightmare",
+    .channels = 20,
+    .rate = 100.0,
+    .burst = 1,
+    .capacity = 4096,
+    .duration = 0.0,
+};
+
+static const struct option long_options[] = {
+    {"help", no_argument, NULL, 'h'},
+    {"name", required_argument, NULL, 'n'},
+    {"channels", required_argument, NULL, 'c'},
+    {"rate", required_argument, NULL, 'r'},
+    {"burst", required_argument, NULL, 'b'},
+    {"capacity", required_argument, NULL, 'C'},
+    {"duration", required_argument, NULL, 'd'},
+    {NULL, 0, NULL, 0},
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int signal)
+{
+    (void)signal;
+    stop_requested = 1;
+}
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  -h, --help            Show this help\n");
+    printf("  -n, --name NAME       Name of the shared memory ring (default /nightmare)\n");
+    printf("  -c, --channels N      Values per sample (default 20)\n");
+    printf("  -r, --rate HZ         Samples per second (default 100)\n");
+    printf("  -b, --burst N         Samples published at once (default 1)\n");
+    printf("  -C, --capacity N      Samples the ring holds, a power of two (default 4096)\n");
+    printf("  -d, --duration SEC    Stop after SEC seconds (default 0 runs until interrupted)\n");
+}
+
+static bool parse_double(const char *text, double *value)
+{
+    char *end;
+    double result = strtod(text, &end);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+
+    (*value) = result;
+    return true;
+}
+
+static bool parse_int(const char *text, int *value)
+{
+    char *end;
+    long result = strtol(text, &end, 0);
+    if (end == text || *end != '\0' || result < 0 || result > 1 << 30)
+    {
+        return false;
+    }
+
+    (*value) = result;
+    return true;
+}
+
+static int64_t get_time_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * SEC_IN_NS + now.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    int option;
+    while ((option = getopt_long(argc, argv, "hn:c:r:b:C:d:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        case 'n':
+            producer_options.name = optarg;
+            break;
+        case 'c':
+            if (!parse_int(optarg, &producer_options.channels) || producer_options.channels < 1)
+            {
+                fprintf(stderr, "Invalid channel count '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'r':
+            if (!parse_double(optarg, &producer_options.rate) || producer_options.rate <= 0.0)
+            {
+                fprintf(stderr, "Invalid rate '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            if (!parse_int(optarg, &producer_options.burst) || producer_options.burst < 1)
+            {
+                fprintf(stderr, "Invalid burst size '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            if (!parse_int(optarg, &producer_options.capacity) || producer_options.capacity < 1 ||
+                (producer_options.capacity & (producer_options.capacity - 1)) != 0)
+            {
+                fprintf(stderr, "Invalid capacity '%s', a power of two is required\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            if (!parse_double(optarg, &producer_options.duration) || producer_options.duration < 0.0)
+            {
+                fprintf(stderr, "Invalid duration '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind < argc)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    float *values = malloc(producer_options.channels * sizeof(float));
+    if (!values)
+    {
+        fprintf(stderr, "Failed to allocate memory for samples\n");
+        return 1;
+    }
+
+    struct ShmRing ring = {0};
+    if (!shm_ring_create(&ring, producer_options.name, producer_options.channels, producer_options.capacity, 0.0f, 1.0f))
+    {
+        fprintf(stderr, "Could not create shared memory ring '%s'\n", producer_options.name);
+        free(values);
+        return 1;
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("Producing %i channels at %.1f samples/s in bursts of %i on '%s'\n", producer_options.channels,
+           producer_options.rate, producer_options.burst, producer_options.name);
+    fflush(stdout);
+
+    // Deadlines are absolute, so the rate does not drift with the time spent publishing
+    int64_t period_ns = producer_options.burst * SEC_IN_NS / producer_options.rate;
+    int64_t started_ns = get_time_ns();
+    int64_t stop_ns = started_ns + (int64_t)(producer_options.duration * SEC_IN_NS);
+    int64_t deadline_ns = started_ns;
+    uint64_t produced = 0;
+    uint64_t published = 0;
+
+    while (!stop_requested && (producer_options.duration == 0.0 || deadline_ns < stop_ns))
+    {
+        for (int i = 0; i < producer_options.burst; i++)
+        {
+            // Every channel is a sine with its own period
+            for (int channel = 0; channel < producer_options.channels; channel++)
+            {
+                double period = 50.0 + 7.0 * channel;
+                values[channel] = 0.5 + 0.45 * sin(2.0 * PI * produced / period);
+            }
+
+            if (shm_ring_push(&ring, get_time_ns(), values))
+            {
+                published++;
+            }
+            produced++;
+        }
+
+        deadline_ns += period_ns;
+        struct timespec deadline = {deadline_ns / SEC_IN_NS, deadline_ns % SEC_IN_NS};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+
+    double elapsed = (double)(get_time_ns() - started_ns) / SEC_IN_NS;
+    printf("Published %llu of %llu samples (%.1f samples/s), %llu dropped on a full ring\n",
+           (unsigned long long)published, (unsigned long long)produced, elapsed > 0.0 ? published / elapsed : 0.0,
+           (unsigned long long)(produced - published));
+
+    shm_ring_close(&ring);
+    shm_unlink(producer_options.name);
+    free(values);
+
+    return 0;
+}
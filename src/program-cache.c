@@ -0,0 +1,329 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "program-cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "common.h"
+
+/*
+ * Program binary cache
+ *
+ * Linked programs are stored on disk with GL_OES_get_program_binary and
+ * loaded instead of compiling the shaders from source. The directory keeps
+ * the driver identification in a file named "driver"; when it changes all
+ * cached binaries are removed.
+ */
+
+struct ProgramCacheStatistics program_cache_statistics;
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2ext.h>
+#include <EGL/egl.h>
+#include "gl-resources.h"
+
+#define PROGRAM_CACHE_MAGIC 0x4350454e // "NEPC"
+#define PROGRAM_CACHE_FILE_EXTENSION ".bin"
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t binary_format;
+    uint64_t key;
+    uint32_t length;
+};
+
+static const char *cache_directory = NULL;
+static char driver[512];
+static PFNGLGETPROGRAMBINARYOESPROC get_program_binary = NULL;
+static PFNGLPROGRAMBINARYOESPROC program_binary = NULL;
+
+// FNV-1a
+static uint64_t hash_string(uint64_t hash, const char *string)
+{
+    for (const unsigned char *c = (const unsigned char *)string; *c; c++)
+    {
+        hash ^= *c;
+        hash *= 0x100000001b3ull;
+    }
+
+    // Separator, so that the boundaries between strings are part of the hash
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+
+    return hash;
+}
+
+static void get_cache_path(char *path, size_t size, uint64_t key)
+{
+    snprintf(path, size, "%s/%016llx%s", cache_directory, (unsigned long long)key, PROGRAM_CACHE_FILE_EXTENSION);
+}
+
+static void purge_cache()
+{
+    DIR *directory = opendir(cache_directory);
+    if (!directory)
+    {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(directory)))
+    {
+        size_t length = strlen(entry->d_name);
+        size_t extension_length = strlen(PROGRAM_CACHE_FILE_EXTENSION);
+        if (length > extension_length && strcmp(entry->d_name + length - extension_length, PROGRAM_CACHE_FILE_EXTENSION) == 0)
+        {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", cache_directory, entry->d_name);
+            remove(path);
+        }
+    }
+
+    closedir(directory);
+}
+
+// Removes all binaries if they have been created by another driver
+static bool validate_driver()
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/driver", cache_directory);
+
+    char cached_driver[sizeof(driver)] = "";
+    FILE *file = fopen(path, "r");
+    if (file)
+    {
+        size_t length = fread(cached_driver, 1, sizeof(cached_driver) - 1, file);
+        cached_driver[length] = '\0';
+        fclose(file);
+    }
+
+    if (strcmp(cached_driver, driver) == 0)
+    {
+        return true;
+    }
+
+    if (cached_driver[0] != '\0')
+    {
+        print("Driver changed, invalidating program cache\n");
+    }
+
+    purge_cache();
+
+    file = fopen(path, "w");
+    if (!file)
+    {
+        print_error("Could not write program cache driver file '%s'\n", path);
+        return false;
+    }
+
+    fputs(driver, file);
+    fclose(file);
+
+    return true;
+}
+
+bool initialize_program_cache(const char *directory)
+{
+    memset(&program_cache_statistics, 0, sizeof(program_cache_statistics));
+
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "GL_OES_get_program_binary"))
+    {
+        print_error("GL does not support GL_OES_get_program_binary\n");
+        return false;
+    }
+
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &format_count);
+    if (format_count <= 0)
+    {
+        print_error("GL does not offer any program binary format\n");
+        return false;
+    }
+
+    get_program_binary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+    program_binary = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+    if (!get_program_binary || !program_binary)
+    {
+        print_error("Could not load GL_OES_get_program_binary functions\n");
+        return false;
+    }
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+    {
+        print_error("Could not create program cache directory '%s'\n", directory);
+        return false;
+    }
+
+    snprintf(driver, sizeof(driver), "%s\n%s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    cache_directory = directory;
+
+    if (!validate_driver())
+    {
+        cache_directory = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void cleanup_program_cache()
+{
+    cache_directory = NULL;
+}
+
+bool is_program_cache_enabled()
+{
+    return cache_directory != NULL;
+}
+
+uint64_t get_program_cache_key(const GLchar *const *parts, size_t part_count)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    hash = hash_string(hash, driver);
+    for (size_t i = 0; i < part_count; i++)
+    {
+        hash = hash_string(hash, parts[i]);
+    }
+
+    return hash;
+}
+
+bool load_cached_program(uint64_t key, GLuint *program)
+{
+    if (!cache_directory)
+    {
+        return false;
+    }
+
+    char path[1024];
+    get_cache_path(path, sizeof(path), key);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        program_cache_statistics.misses++;
+        return false;
+    }
+
+    struct ProgramCacheHeader header;
+    void *binary = NULL;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == PROGRAM_CACHE_MAGIC &&
+                 header.key == key &&
+                 header.length > 0 &&
+                 (binary = malloc(header.length)) != NULL &&
+                 fread(binary, header.length, 1, file) == 1;
+    fclose(file);
+
+    GLuint _program = 0;
+    if (valid)
+    {
+        _program = glCreateProgram();
+        register_gl_resource(GL_RESOURCE_PROGRAM, _program);
+
+        program_binary(_program, header.binary_format, binary, header.length);
+
+        // The driver may reject binaries, e.g. after an update with the same version string
+        GLint linked = 0;
+        glGetProgramiv(_program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            delete_gl_resource(GL_RESOURCE_PROGRAM, _program);
+            valid = false;
+        }
+    }
+
+    free(binary);
+
+    if (!valid)
+    {
+        remove(path);
+        program_cache_statistics.misses++;
+        return false;
+    }
+
+    (*program) = _program;
+    program_cache_statistics.hits++;
+
+    return true;
+}
+
+void store_cached_program(uint64_t key, GLuint program)
+{
+    if (!cache_directory)
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    void *binary = malloc((size_t)length);
+    if (!binary)
+    {
+        return;
+    }
+
+    struct ProgramCacheHeader header = {PROGRAM_CACHE_MAGIC, 0, key, 0};
+    GLenum binary_format;
+    GLsizei written = 0;
+    get_program_binary(program, length, &written, &binary_format, binary);
+    header.binary_format = binary_format;
+    header.length = (uint32_t)written;
+
+    char path[1024];
+    get_cache_path(path, sizeof(path), key);
+
+    // Written to a temporary file first, so a crash never leaves a truncated binary behind
+    char temporary_path[1040];
+    snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+    FILE *file = fopen(temporary_path, "wb");
+    if (file)
+    {
+        bool success = written > 0 &&
+                       fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       fwrite(binary, (size_t)written, 1, file) == 1;
+        success = fclose(file) == 0 && success;
+
+        if (success && rename(temporary_path, path) == 0)
+        {
+            program_cache_statistics.stores++;
+        }
+        else
+        {
+            remove(temporary_path);
+        }
+    }
+
+    free(binary);
+}
+#else
+bool initialize_program_cache(const char *directory)
+{
+    (void)directory;
+    print_error("The program cache requires GLES2\n");
+    return false;
+}
+
+void cleanup_program_cache()
+{
+}
+
+bool is_program_cache_enabled()
+{
+    return false;
+}
+#endif
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct ProgramCacheStatistics
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+};
+
+extern struct ProgramCacheStatistics program_cache_statistics;
+
+bool initialize_program_cache(const char *directory);
+void cleanup_program_cache();
+bool is_program_cache_enabled();
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+
+// Keys are derived from the given key material and the driver (GL_RENDERER, GL_VERSION)
+uint64_t get_program_cache_key(const GLchar *const *parts, size_t part_count);
+bool load_cached_program(uint64_t key, GLuint *program);
+void store_cached_program(uint64_t key, GLuint program);
+#endif
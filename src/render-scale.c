@@ -0,0 +1,178 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "render-scale.h"
+
+#include "common.h"
+#include "egl.h"
+#include "gl-resources.h"
+
+/*
+ * Render resolution scaling
+ *
+ * Scenes render into an offscreen framebuffer with a fraction of the screen
+ * resolution, which is then upscaled to the window with a textured quad.
+ */
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+
+static GLchar vertex_shader_source[] =
+    "attribute vec2 a_position;"
+    "varying vec2 v_texcoord;"
+    "void main()"
+    "{"
+    "v_texcoord = a_position * 0.5 + 0.5;"
+    "gl_Position = vec4(a_position, 0.0, 1.0);"
+    "}";
+
+static GLchar fragment_shader_source[] =
+    "precision mediump float;"
+    "uniform sampler2D u_texture;"
+    "varying vec2 v_texcoord;"
+    "void main()"
+    "{"
+    "gl_FragColor = texture2D(u_texture, v_texcoord);"
+    "}";
+
+static const GLfloat quad[] = {
+    -1.0, -1.0,
+    1.0, -1.0,
+    -1.0, 1.0,
+    1.0, 1.0};
+
+static GLuint framebuffer = 0;
+static GLuint texture = 0;
+static GLuint shader_program = 0;
+static GLuint a_position = 0;
+static GLint u_texture;
+
+bool initialize_render_scale(float scale)
+{
+    render_width = (int)(screen_width * scale);
+    render_height = (int)(screen_height * scale);
+    if (render_width < 1 || render_height < 1)
+    {
+        print_error("Render scale %f results in an empty framebuffer\n", scale);
+        return false;
+    }
+
+    // Color buffer, sampled by the upscale pass
+    glGenTextures(1, &texture);
+    register_gl_resource(GL_RESOURCE_TEXTURE, texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, render_width, render_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &framebuffer);
+    register_gl_resource(GL_RESOURCE_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        print_error("Offscreen framebuffer is incomplete (status: %x)\n", status);
+        cleanup_render_scale();
+        return false;
+    }
+
+    // Upscale program
+    const struct AttributeBinding bindings[] = {{a_position, "a_position"}};
+    if (!build_program(&shader_program, vertex_shader_source, fragment_shader_source, bindings, 1))
+    {
+        print_error("Failed to build GL program for upscaling\n");
+        shader_program = 0;
+        cleanup_render_scale();
+        return false;
+    }
+
+    u_texture = glGetUniformLocation(shader_program, "u_texture");
+
+    return true;
+}
+
+void cleanup_render_scale()
+{
+    if (shader_program)
+    {
+        delete_gl_resource(GL_RESOURCE_PROGRAM, shader_program);
+        shader_program = 0;
+    }
+
+    if (framebuffer)
+    {
+        delete_gl_resource(GL_RESOURCE_FRAMEBUFFER, framebuffer);
+        framebuffer = 0;
+    }
+
+    if (texture)
+    {
+        delete_gl_resource(GL_RESOURCE_TEXTURE, texture);
+        texture = 0;
+    }
+
+    render_width = screen_width;
+    render_height = screen_height;
+}
+
+void render_scale_begin_frame()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, render_width, render_height);
+}
+
+void render_scale_present()
+{
+    // Scenes set up their program once, so it has to be restored afterwards
+    GLint scene_program;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &scene_program);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screen_width, screen_height);
+
+    glUseProgram(shader_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(u_texture, 0);
+
+    // The attribute array may be in use by the scene as well
+    GLint attribute_enabled;
+    glGetVertexAttribiv(a_position, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &attribute_enabled);
+
+    glEnableVertexAttribArray(a_position);
+    glVertexAttribPointer(a_position, 2, GL_FLOAT, GL_FALSE, 0, quad);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    if (!attribute_enabled)
+    {
+        glDisableVertexAttribArray(a_position);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram((GLuint)scene_program);
+}
+#else
+bool initialize_render_scale(float scale)
+{
+    (void)scale;
+    print_error("Render scaling requires GLES2\n");
+    return false;
+}
+
+void cleanup_render_scale()
+{
+}
+
+void render_scale_begin_frame()
+{
+}
+
+void render_scale_present()
+{
+}
+#endif
@@ -0,0 +1,12 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdbool.h>
+
+bool initialize_render_scale(float scale);
+void cleanup_render_scale();
+
+void render_scale_begin_frame();
+void render_scale_present();
@@ -0,0 +1,426 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "results.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "common.h"
+#include "startup.h"
+#include "results-format.h"
+
+/*
+ * Results
+ *
+ * Collects the results of every scene and writes them with the records of
+ * the results format (see results-format.c).
+ */
+
+#define MAX_ENVIRONMENT_ENTRIES 32
+
+struct EnvironmentEntry
+{
+    char *key;
+    char *value;
+};
+
+static struct SceneResult *results = NULL;
+static size_t results_count = 0;
+static size_t results_capacity = 0;
+
+static struct EnvironmentEntry environment[MAX_ENVIRONMENT_ENTRIES];
+static size_t environment_count = 0;
+
+bool frame_samples_append(struct FrameSamples *samples, const struct FrameSample *sample)
+{
+    if (samples->count == samples->capacity)
+    {
+        size_t capacity = samples->capacity > 0 ? samples->capacity * 2 : 4096;
+        struct FrameSample *_samples = realloc(samples->samples, capacity * sizeof(struct FrameSample));
+        if (!_samples)
+        {
+            print_error("Failed to allocate memory for frame samples\n");
+            return false;
+        }
+
+        samples->samples = _samples;
+        samples->capacity = capacity;
+    }
+
+    samples->samples[samples->count++] = (*sample);
+
+    return true;
+}
+
+void frame_samples_free(struct FrameSamples *samples)
+{
+    free(samples->samples);
+    samples->samples = NULL;
+    samples->count = 0;
+    samples->capacity = 0;
+}
+
+static int compare_frame_ns(const void *a, const void *b)
+{
+    int64_t frame_a = *(const int64_t *)a;
+    int64_t frame_b = *(const int64_t *)b;
+
+    return (frame_a > frame_b) - (frame_a < frame_b);
+}
+
+// Nearest rank percentile of the frame times in milliseconds
+double get_frame_percentile_ms(const struct FrameSamples *samples, double percentile)
+{
+    if (samples->count == 0)
+    {
+        return 0.0;
+    }
+
+    int64_t *frames = malloc(samples->count * sizeof(int64_t));
+    if (!frames)
+    {
+        return 0.0;
+    }
+
+    for (size_t i = 0; i < samples->count; i++)
+    {
+        frames[i] = samples->samples[i].frame_ns;
+    }
+
+    qsort(frames, samples->count, sizeof(int64_t), compare_frame_ns);
+
+    size_t rank = (size_t)ceil(percentile / 100.0 * samples->count);
+    int64_t frame_ns = frames[rank > 0 ? rank - 1 : 0];
+    free(frames);
+
+    return (double)frame_ns / 1e6;
+}
+
+void result_add_parameter(struct SceneResult *result, const char *key, double value)
+{
+    if (result->parameter_count < MAX_RESULT_VALUES)
+    {
+        struct ResultValue parameter = {key, value};
+        result->parameters[result->parameter_count++] = parameter;
+    }
+}
+
+void result_add_metric(struct SceneResult *result, const char *key, double value)
+{
+    if (result->metric_count < MAX_RESULT_VALUES)
+    {
+        struct ResultValue metric = {key, value};
+        result->metrics[result->metric_count++] = metric;
+    }
+}
+
+bool results_add(const struct SceneResult *result)
+{
+    if (results_count == results_capacity)
+    {
+        size_t capacity = results_capacity > 0 ? results_capacity * 2 : 8;
+        struct SceneResult *_results = realloc(results, capacity * sizeof(struct SceneResult));
+        if (!_results)
+        {
+            print_error("Failed to allocate memory for results\n");
+            return false;
+        }
+
+        results = _results;
+        results_capacity = capacity;
+    }
+
+    results[results_count++] = (*result);
+
+    return true;
+}
+
+void results_set_environment(const char *key, const char *value)
+{
+    for (size_t i = 0; i < environment_count; i++)
+    {
+        if (strcmp(environment[i].key, key) == 0)
+        {
+            free(environment[i].value);
+            environment[i].value = strdup(value ? value : "");
+            return;
+        }
+    }
+
+    if (environment_count < MAX_ENVIRONMENT_ENTRIES)
+    {
+        environment[environment_count].key = strdup(key);
+        environment[environment_count].value = strdup(value ? value : "");
+        environment_count++;
+    }
+}
+
+void results_print_summary()
+{
+    // Benchmarks without a frame loop report their own tables
+    size_t frame_results = 0;
+    for (size_t i = 0; i < results_count; i++)
+    {
+        frame_results += results[i].frames > 0;
+    }
+
+    if (frame_results == 0)
+    {
+        return;
+    }
+
+    print("Summary\n");
+    print("-------\n");
+    print("%-8s %-12s %-6s %-7s %-7s %-6s %-7s %-7s %-6s %-24s %10s %10s\n",
+          "config", "RGBA", "depth", "stencil", "samples", "scale", "AA", "lines", "API", "scene", "FPS", "frame ms");
+
+    for (size_t i = 0; i < results_count; i++)
+    {
+        const struct SceneResult *result = &results[i];
+        const struct EglConfigInfo *config = &result->config;
+
+        if (result->frames == 0)
+        {
+            continue;
+        }
+
+        char format[16];
+        snprintf(format, sizeof(format), "%i/%i/%i/%i", config->red_size, config->green_size, config->blue_size, config->alpha_size);
+
+        print("0x%-6x %-12s %-6i %-7i %-7i %-6.2f %-7s %-7s %-6s %-24s %10.2f %10.3f\n",
+              config->id, format, config->depth_size, config->stencil_size, config->samples,
+              result->render_scale, get_antialiasing_name(result->antialiasing), get_line_mode_name(result->line_mode),
+              result->backend, result->scene_name,
+              result->fps, result->fps > 0.0 ? 1000.0 / result->fps : 0.0);
+    }
+
+    print("\n");
+}
+
+void get_average_perf_counters(const struct SceneResult *result, struct PerfCounterValues *update, struct PerfCounterValues *draw)
+{
+    memset(update, 0, sizeof(*update));
+    memset(draw, 0, sizeof(*draw));
+
+    size_t count = result->frame_samples.count;
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct FrameSample *sample = &result->frame_samples.samples[i];
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+        {
+            update->values[c] += sample->update_counters.values[c];
+            draw->values[c] += sample->draw_counters.values[c];
+        }
+    }
+
+    for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+    {
+        update->values[c] /= count;
+        draw->values[c] /= count;
+    }
+}
+
+static void write_scene_result(FILE *file, const struct SceneResult *result)
+{
+    const struct EglConfigInfo *config = &result->config;
+
+    write_scene_record(file, result->scene_name);
+
+    write_parameter_record(file, "backend", "%s", result->backend);
+    write_parameter_record(file, "config_id", "0x%x", config->id);
+    write_parameter_record(file, "rgba", "%i/%i/%i/%i", config->red_size, config->green_size, config->blue_size, config->alpha_size);
+    write_parameter_record(file, "depth", "%i", config->depth_size);
+    write_parameter_record(file, "stencil", "%i", config->stencil_size);
+    write_parameter_record(file, "samples", "%i", config->samples);
+    write_parameter_record(file, "render_scale", "%.2f", result->render_scale);
+    write_parameter_record(file, "antialiasing", "%s", get_antialiasing_name(result->antialiasing));
+    if (result->line_width > 0.0f)
+    {
+        write_parameter_record(file, "lines", "%s", get_line_mode_name(result->line_mode));
+        write_parameter_record(file, "line_join", "%s", get_line_join_name(result->line_join));
+        write_parameter_record(file, "line_width", "%g", result->line_width);
+    }
+    if (result->decimation != DECIMATION_NONE)
+    {
+        write_parameter_record(file, "decimation", "%s", get_decimation_name(result->decimation));
+    }
+    for (size_t i = 0; i < result->parameter_count; i++)
+    {
+        write_parameter_record(file, result->parameters[i].key, "%g", result->parameters[i].value);
+    }
+
+    write_metric_record(file, "initialize_ms", "%f", result->initialize_time);
+    write_metric_record(file, "frames", "%llu", (unsigned long long)result->frames);
+    write_metric_record(file, "elapsed_s", "%f", result->elapsed_time);
+    write_metric_record(file, "fps", "%f", result->fps);
+    if (result->render_scale < 1.0f)
+    {
+        write_metric_record(file, "scene_ms", "%f", result->scene_time);
+        write_metric_record(file, "upscale_ms", "%f", result->upscale_time);
+    }
+
+    for (size_t i = 0; i < result->metric_count; i++)
+    {
+        write_metric_record(file, result->metrics[i].key, "%f", result->metrics[i].value);
+    }
+
+    struct PerfCounterValues update_average, draw_average;
+    get_average_perf_counters(result, &update_average, &draw_average);
+    for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+    {
+        if (result->perf_counters & (1u << c))
+        {
+            char key[64];
+            snprintf(key, sizeof(key), "update_%s_per_frame", get_perf_counter_name(c));
+            write_metric_record(file, key, "%llu", (unsigned long long)update_average.values[c]);
+            snprintf(key, sizeof(key), "draw_%s_per_frame", get_perf_counter_name(c));
+            write_metric_record(file, key, "%llu", (unsigned long long)draw_average.values[c]);
+        }
+    }
+
+    begin_results_record(file, RESULTS_RECORD_FRAME_COLUMNS);
+    add_results_field(file, "frame_ns");
+    if (result->perf_counters)
+    {
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+        {
+            if (result->perf_counters & (1u << c))
+            {
+                add_results_field(file, "update_%s", get_perf_counter_name(c));
+                add_results_field(file, "draw_%s", get_perf_counter_name(c));
+            }
+        }
+    }
+    // Frame and sensor times are relative to the start of the first frame
+    const struct SensorSamples *sensor_samples = &result->sensor_samples;
+    int64_t origin_ns = result->frame_samples.count > 0 ? result->frame_samples.samples[0].started_ns : 0;
+    if (sensor_samples->count > 0)
+    {
+        add_results_field(file, "started_ns");
+        add_results_field(file, "throttled");
+    }
+    end_results_record(file);
+
+    for (size_t i = 0; i < result->frame_samples.count; i++)
+    {
+        const struct FrameSample *sample = &result->frame_samples.samples[i];
+
+        begin_results_record(file, RESULTS_RECORD_FRAME);
+        add_results_field(file, "%lld", (long long)sample->frame_ns);
+        if (result->perf_counters)
+        {
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+            {
+                if (result->perf_counters & (1u << c))
+                {
+                    add_results_field(file, "%llu", (unsigned long long)sample->update_counters.values[c]);
+                    add_results_field(file, "%llu", (unsigned long long)sample->draw_counters.values[c]);
+                }
+            }
+        }
+        if (sensor_samples->count > 0)
+        {
+            add_results_field(file, "%lld", (long long)(sample->started_ns - origin_ns));
+            add_results_field(file, "%i", sample->throttled);
+        }
+        end_results_record(file);
+    }
+
+    if (sensor_samples->count > 0)
+    {
+        begin_results_record(file, RESULTS_RECORD_SENSOR_COLUMNS);
+        add_results_field(file, "time_ns");
+        add_results_field(file, "throttled");
+        for (size_t s = 0; s < get_sensor_count(); s++)
+        {
+            add_results_field(file, "%s", get_sensor_name(s));
+        }
+        end_results_record(file);
+
+        for (size_t i = 0; i < sensor_samples->count; i++)
+        {
+            const struct SensorSample *sample = &sensor_samples->samples[i];
+
+            begin_results_record(file, RESULTS_RECORD_SENSOR);
+            add_results_field(file, "%lld", (long long)(sample->time_ns - origin_ns));
+            add_results_field(file, "%i", sample->throttled);
+            for (size_t s = 0; s < get_sensor_count(); s++)
+            {
+                add_results_field(file, "%lld", (long long)sample->values[s]);
+            }
+            end_results_record(file);
+        }
+    }
+
+    write_end_record(file);
+}
+
+bool results_write(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        print_error("Could not open results file '%s'\n", path);
+        return false;
+    }
+
+    write_results_header(file);
+
+    for (size_t i = 0; i < environment_count; i++)
+    {
+        write_environment_record(file, environment[i].key, environment[i].value);
+    }
+
+    const struct StartupStage *stages;
+    size_t stages_count = get_startup_stages(&stages);
+    for (size_t i = 0; i < stages_count; i++)
+    {
+        write_startup_record(file, stages[i].name, stages[i].duration_ns / 1e6, stages[i].finished_ns / 1e6);
+    }
+
+    for (size_t i = 0; i < results_count; i++)
+    {
+        write_scene_result(file, &results[i]);
+    }
+
+    bool success = !ferror(file);
+    fclose(file);
+
+    if (!success)
+    {
+        print_error("Could not write results file '%s'\n", path);
+        return false;
+    }
+
+    print("Results written to '%s'\n", path);
+
+    return true;
+}
+
+void results_cleanup()
+{
+    for (size_t i = 0; i < results_count; i++)
+    {
+        frame_samples_free(&results[i].frame_samples);
+        sensor_samples_free(&results[i].sensor_samples);
+    }
+
+    free(results);
+    results = NULL;
+    results_count = 0;
+    results_capacity = 0;
+
+    for (size_t i = 0; i < environment_count; i++)
+    {
+        free(environment[i].key);
+        free(environment[i].value);
+    }
+    environment_count = 0;
+}
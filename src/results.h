@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "egl.h"
+#include "options.h"
+#include "perf-counters.h"
+#include "sensors.h"
+
+struct FrameSample
+{
+    int64_t frame_ns;
+    // CLOCK_MONOTONIC time the frame started at
+    int64_t started_ns;
+    // Rendered while a sensor reported throttling (only set with sensor sampling)
+    bool throttled;
+    // Counter deltas of the update and draw phase (only recorded with performance counters)
+    struct PerfCounterValues update_counters;
+    struct PerfCounterValues draw_counters;
+};
+
+struct FrameSamples
+{
+    struct FrameSample *samples;
+    size_t count;
+    size_t capacity;
+};
+
+#define MAX_RESULT_VALUES 32
+
+struct ResultValue
+{
+    const char *key;
+    double value;
+};
+
+struct SceneResult
+{
+    const char *scene_name;
+    // Name of the backend the scene ran on
+    const char *backend;
+    struct EglConfigInfo config;
+    uint64_t frames;
+    double elapsed_time;
+    double fps;
+    float render_scale;
+    enum Antialiasing antialiasing;
+    // Line geometry, the width is 0 for benchmarks which draw no lines
+    enum LineMode line_mode;
+    enum LineJoin line_join;
+    float line_width;
+    // Decimation of the lines, none for scenes which do not decimate
+    enum Decimation decimation;
+    // Time of the scene initialize() in ms
+    double initialize_time;
+    // Average time of the scene and the upscale pass in ms (only measured with render scaling)
+    double scene_time;
+    double upscale_time;
+    // Bit per recorded performance counter (see get_perf_counter_mask)
+    uint32_t perf_counters;
+    // Owned by the results once added
+    struct FrameSamples frame_samples;
+    // Owned by the results once added (empty without sensor sampling)
+    struct SensorSamples sensor_samples;
+    // Additional scene specific parameters and metrics
+    struct ResultValue parameters[MAX_RESULT_VALUES];
+    size_t parameter_count;
+    struct ResultValue metrics[MAX_RESULT_VALUES];
+    size_t metric_count;
+};
+
+bool frame_samples_append(struct FrameSamples *samples, const struct FrameSample *sample);
+void frame_samples_free(struct FrameSamples *samples);
+double get_frame_percentile_ms(const struct FrameSamples *samples, double percentile);
+
+void get_average_perf_counters(const struct SceneResult *result, struct PerfCounterValues *update, struct PerfCounterValues *draw);
+
+void result_add_parameter(struct SceneResult *result, const char *key, double value);
+void result_add_metric(struct SceneResult *result, const char *key, double value);
+
+bool results_add(const struct SceneResult *result);
+void results_set_environment(const char *key, const char *value);
+void results_print_summary();
+bool results_write(const char *path);
+void results_cleanup();
@@ -9,8 +9,14 @@
 #include <math.h>
 #include "common.h"
 #include "egl.h"
-#include "random.h"
+#include "data-source.h"
 #include "scenes.h"
+#include "damage.h"
+#include "options.h"
+#include "lines.h"
+#include "trace.h"
+#include "gl-resources.h"
+#include "decimation.h"
 
 #ifdef NIGHTMARE_USE_GLES1
 #include <GLES/gl.h>
@@ -22,15 +28,27 @@ static bool initialize();
 static void update(int64_t delta_ns);
 static void draw();
 static void deinitialize();
+static bool is_dirty();
+static int64_t get_next_change();
+static void set_load(size_t lines, size_t points);
+static void get_load(size_t *lines, size_t *points);
 static inline float *get_x_value(size_t line_index, size_t point_index);
 static inline float *get_y_value(size_t line_index, size_t point_index);
+static void add_point_damage(size_t point_index);
 
 struct Scene floating_graph_scene = {
     .name = "Floating graph",
+    .reports_damage = true,
+    .thick_lines = true,
+    .decimates = true,
     .initialize = initialize,
     .update = update,
     .draw = draw,
-    .deinitialize = deinitialize};
+    .deinitialize = deinitialize,
+    .is_dirty = is_dirty,
+    .get_next_change = get_next_change,
+    .set_load = set_load,
+    .get_load = get_load};
 
 // Parameters
 static size_t line_count = 20;
@@ -51,6 +69,12 @@ static float *data;
 static size_t current_count;
 static float z_rotation;
 static float scale;
+static float damaged_z_rotation;
+static float damaged_scale;
+// Whether update() changed what draw() shows since the last draw
+static bool dirty;
+
+static const float line_color[4] = {0.91, 0.77, 0.42, 1.0};
 
 #ifdef NIGHTMARE_USE_GLES1
 static GLuint vbo;
@@ -150,7 +174,10 @@ static bool initialize()
     point_add_timer = 0;
     z_rotation = 0.0;
     scale = 1.0;
-    reset_random();
+    damaged_z_rotation = z_rotation;
+    damaged_scale = scale;
+    dirty = true;
+    reset_data_source();
 
     // Initialize lines data
     data_size = 2 * line_count * point_count * sizeof(float);
@@ -169,26 +196,27 @@ static bool initialize()
     }
 
     // Setup graphics
+    if (!initialize_decimation(line_count, point_count, render_width, false))
+    {
+        return false;
+    }
+
+    // Decimated lines can be longer than tiny undecimated ones
+    size_t drawn_points = get_decimated_capacity() > point_count ? get_decimated_capacity() : point_count;
+
 #ifdef NIGHTMARE_USE_GLES1
     glGenBuffers(1, &vbo);
-    glEnableClientState(GL_VERTEX_ARRAY);
+    register_gl_resource(GL_RESOURCE_BUFFER, vbo);
+    enable_gl_state(GL_STATE_CLIENT_STATE, GL_VERTEX_ARRAY);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
     glColor4f(0.91f, 0.77f, 0.42f, 1.0f);
 #elif defined NIGHTMARE_USE_GLES2
-    bool success = create_program(&shader_program, vertex_shader_source, fragment_shader_source);
+    const struct AttributeBinding bindings[] = {{a_coord, "a_coord"}};
+    bool success = build_program(&shader_program, vertex_shader_source, fragment_shader_source, bindings, 1);
     if (!success)
     {
-        print_error("Failed to create GL program for floating graph scene\n");
-        return false;
-    }
-
-    glBindAttribLocation(shader_program, a_coord, "a_coord");
-
-    success = link_program(shader_program);
-    if (!success)
-    {
-        print_error("Failed to link GL program for floating graph scene\n");
+        print_error("Failed to build GL program for floating graph scene\n");
         return false;
     }
 
@@ -197,12 +225,18 @@ static bool initialize()
     u_rotation_matrix = glGetUniformLocation(shader_program, "u_rotation_matrix");
     u_scale_matrix = glGetUniformLocation(shader_program, "u_scale_matrix");
 
-    glEnableVertexAttribArray(a_coord);
+    enable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, a_coord);
 #endif
 
-    glViewport(0, 0, screen_width, screen_height);
+    glViewport(0, 0, render_width, render_height);
     glClearColor(0.16f, 0.62f, 0.56f, 1.0f);
-    glLineWidth(2.0f);
+    glLineWidth(options.line_width);
+
+    if (use_line_renderer() && !initialize_line_renderer(line_count, drawn_points))
+    {
+        print_error("Failed to initialize line renderer for floating graph scene\n");
+        return false;
+    }
 
     return true;
 }
@@ -210,7 +244,12 @@ static bool initialize()
 static void update(int64_t delta_ns)
 {
     point_add_timer -= delta_ns;
-    general_timer += delta_ns;
+
+    // A still scene neither scales nor rotates
+    if (options.animation)
+    {
+        general_timer += delta_ns;
+    }
 
     // Update scale
     if (general_timer >= time_to_scale + scale_interval)
@@ -249,17 +288,31 @@ static void update(int64_t delta_ns)
     update_scale_matrix();
 #endif
 
-    if (point_add_timer <= 0)
+    // Any change of the transformation moves every line
+    if (z_rotation != damaged_z_rotation || scale != damaged_scale)
     {
-        // Reset timer
-        point_add_timer += point_add_interval;
+        damaged_z_rotation = z_rotation;
+        damaged_scale = scale;
+        damage_add_full();
+        dirty = true;
+    }
+
+    // Samples which arrived in a burst are all added within this frame
+    size_t steps = get_data_steps(&point_add_timer, point_add_interval, point_count);
+    for (size_t step = 0; step < steps; step++)
+    {
+        dirty = true;
 
         if (current_count < point_count)
         {
             current_count++;
+            add_point_damage(current_count - 1);
         }
         else
         {
+            // Scrolling moves every point
+            damage_add_full();
+
             for (size_t li = 0; li < line_count; li++)
             {
                 for (size_t pi = 0; pi < point_count - 1; pi++)
@@ -271,29 +324,58 @@ static void update(int64_t delta_ns)
             }
         }
 
-        // Add random point
+        // Add the next sample of every line
         for (size_t li = 0; li < line_count; li++)
         {
             float *y = get_y_value(li, current_count - 1);
-            float d = get_random_float();
+            float d = get_data_sample(li);
             *y = d * 2.0 - 1.0;
+            add_decimation_sample(li, *y);
         }
+        advance_data_source();
+        advance_decimation();
     }
 }
 
 static void draw()
 {
+    dirty = false;
     glClear(GL_COLOR_BUFFER_BIT);
 
+    // Lines with more samples than pixel columns are reduced first
+    const void *lines = data;
+    size_t stride = point_count;
+    size_t count = current_count;
+    if (is_decimation_active())
+    {
+        struct TraceSpan decimate_span = trace_begin("decimate");
+        lines = decimate_lines(&count);
+        stride = get_decimated_capacity();
+        trace_end(&decimate_span);
+    }
+
+    if (use_line_renderer())
+    {
+        draw_lines(lines, GL_FLOAT, line_count, stride, count, z_rotation, scale, line_color);
+        return;
+    }
+
 #ifdef NIGHTMARE_USE_GLES1
     glVertexPointer(2, GL_FLOAT, 0, NULL);
-    glBufferData(GL_ARRAY_BUFFER, data_size, data, GL_DYNAMIC_DRAW);
+
+    struct TraceSpan upload_span = trace_begin("upload");
+    size_t size = 2 * line_count * stride * sizeof(GLfloat);
+    glBufferData(GL_ARRAY_BUFFER, size, lines, GL_DYNAMIC_DRAW);
+    add_uploaded_bytes(size);
+    trace_end(&upload_span);
 
     glPushMatrix();
     glScalef(scale, scale, 1.0);
     glRotatef(z_rotation / PI * 180.0, 0.0, 0.0, 1.0);
 #elif defined NIGHTMARE_USE_GLES2
-    glVertexAttribPointer(a_coord, 2, GL_FLOAT, GL_FALSE, 0, data);
+    // Client side arrays are copied by the driver on every draw
+    add_uploaded_bytes(line_count * count * 2 * sizeof(GLfloat));
+    glVertexAttribPointer(a_coord, 2, GL_FLOAT, GL_FALSE, 0, lines);
 
     glUniformMatrix4fv(u_rotation_matrix, 1, GL_FALSE, z_rotation_matrix);
     glUniformMatrix4fv(u_scale_matrix, 1, GL_FALSE, scale_matrix);
@@ -301,7 +383,7 @@ static void draw()
 
     for (int li = 0; li < line_count; li++)
     {
-        glDrawArrays(GL_LINE_STRIP, li * point_count, current_count);
+        glDrawArrays(GL_LINE_STRIP, li * stride, count);
     }
 
 #ifdef NIGHTMARE_USE_GLES1
@@ -312,8 +394,59 @@ static void draw()
 static void deinitialize()
 {
     free(data);
+    data = NULL;
+    cleanup_decimation();
 
-    // TODO: reset graphics
+    if (use_line_renderer())
+    {
+        cleanup_line_renderer();
+    }
+
+#ifdef NIGHTMARE_USE_GLES1
+    disable_gl_state(GL_STATE_CLIENT_STATE, GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    delete_gl_resource(GL_RESOURCE_BUFFER, vbo);
+    vbo = 0;
+#elif defined NIGHTMARE_USE_GLES2
+    disable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, a_coord);
+    glUseProgram(0);
+    delete_gl_resource(GL_RESOURCE_PROGRAM, shader_program);
+    shader_program = 0;
+#endif
+}
+
+static bool is_dirty()
+{
+    return dirty;
+}
+
+static int64_t get_next_change()
+{
+    int64_t next_change = get_data_next_change(point_add_timer);
+    if (!options.animation || general_timer < time_to_scale)
+    {
+        return options.animation && time_to_scale - general_timer < next_change ? time_to_scale - general_timer : next_change;
+    }
+
+    // Scaling and rotating change the scene every frame
+    if (general_timer < time_to_scale + scale_interval || general_timer >= time_to_rotate)
+    {
+        return 0;
+    }
+
+    return time_to_rotate - general_timer < next_change ? time_to_rotate - general_timer : next_change;
+}
+
+static void set_load(size_t lines, size_t points)
+{
+    line_count = lines;
+    point_count = points;
+}
+
+static void get_load(size_t *lines, size_t *points)
+{
+    (*lines) = line_count;
+    (*points) = point_count;
 }
 
 static inline float *get_x_value(size_t line_index, size_t point_index)
@@ -325,3 +458,29 @@ static inline float *get_y_value(size_t line_index, size_t point_index)
 {
     return get_x_value(line_index, point_index) + 1;
 }
+
+// Reports the columns of the segments which end at and before the given point as damaged
+static void add_point_damage(size_t point_index)
+{
+    // The new point also changes the join at the end of the previous segment
+    size_t first_index = point_index > 1 ? point_index - 2 : 0;
+    float x0 = *get_x_value(0, first_index);
+    float x1 = *get_x_value(0, point_index);
+
+    // Transform the corners of the column like the vertices are transformed
+    float corners[4][2] = {{x0, -1.0}, {x1, -1.0}, {x0, 1.0}, {x1, 1.0}};
+    float s = sinf(z_rotation) * scale;
+    float c = cosf(z_rotation) * scale;
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for (int i = 0; i < 4; i++)
+    {
+        float x = c * corners[i][0] - s * corners[i][1];
+        float y = s * corners[i][0] + c * corners[i][1];
+        min_x = fminf(min_x, x);
+        min_y = fminf(min_y, y);
+        max_x = fmaxf(max_x, x);
+        max_y = fmaxf(max_y, y);
+    }
+
+    damage_add_ndc_rect(min_x, min_y, max_x, max_y, get_line_damage_margin());
+}
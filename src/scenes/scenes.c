@@ -5,91 +5,1183 @@
 
 #include <time.h>
 #include <stdint.h>
+#include <sys/resource.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include "common.h"
 #include "floating-graph.h"
 #include "fixed-graph.h"
+#include "texture-graph.h"
+#include "text.h"
 #include "signal-handler.h"
 #include "egl.h"
+#include "damage.h"
+#include "options.h"
+#include "results.h"
+#include "render-scale.h"
+#include "trace.h"
+#include "perf-counters.h"
+#include "sensors.h"
+#include "event-loop.h"
+#include "data-source.h"
+#include "gl-resources.h"
+#include "program-cache.h"
+#include "startup.h"
+#include "harness.h"
+#include "decimation.h"
+#include "backend.h"
+
+#ifdef NIGHTMARE_USE_GLES1
+#include <GLES/gl.h>
+#elif defined NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+#endif
 
-size_t scenes_count = 2;
 struct Scene *scenes[] = {
     &floating_graph_scene,
     &fixed_graph_scene,
+#ifdef NIGHTMARE_USE_GLES2
+    &texture_graph_scene,
+#endif
+    &batched_text_scene,
+    &per_glyph_text_scene,
+};
+size_t scenes_count = sizeof(scenes) / sizeof(scenes[0]);
+
+// Every n-th frame is serialized with glFinish to split the GPU time between scene and upscale pass
+#define RENDER_SCALE_SAMPLE_INTERVAL 16
+
+// Scene time advanced per frame when a fixed frame count is rendered, makes
+// the rendered content independent of the speed of the machine
+#define FIXED_TIME_STEP_NS (SEC_IN_NS / 60)
+
+// Time each scene runs unless a fixed frame count is rendered
+#define SCENE_DURATION_NS (15 * SEC_IN_NS)
+
+// Frames per capacity search probe unless a frame count is given
+#define CAPACITY_PROBE_FRAMES 240
+#define MAX_CAPACITY_LINES 65536
+
+// Largest difference of a colour channel the decimation check still counts as
+// the same pixel, blended line edges differ slightly with other vertices
+#define DECIMATION_CHANNEL_TOLERANCE 16
+
+// Results keep the metric names by reference
+static const char *surface_metric_names[MAX_SURFACES] = {
+    "surface0_ms", "surface1_ms", "surface2_ms", "surface3_ms",
+    "surface4_ms", "surface5_ms", "surface6_ms", "surface7_ms",
 };
 
-static bool run_scene(struct Scene *scene);
+static bool partial_update_supported = false;
+static bool render_scaled = false;
+static uint64_t uploaded_bytes = 0;
+static uint64_t draw_calls = 0;
+
+static bool run_scene(struct Scene *scene, double *p99_ms);
+static bool search_capacity(struct Scene *scene);
+static bool draw_damaged(struct Scene *scene, uint64_t *repainted_pixels);
+static void print_perf_counters(const char *phase, const struct PerfCounterValues *values, uint32_t mask);
+static void draw_scene(struct Scene *scene);
+static void present_render_scale();
+static void swap_buffers();
+static bool is_output_blank();
+static bool measure_decimation_error(struct Scene *scene, double *percent);
 
 bool run_scenes()
 {
-    for (int i = 0; i < scenes_count; i++)
+    if (!begin_scenes())
     {
-        if (!run_scene(scenes[i]))
+        return false;
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < scenes_count; i++)
+    {
+        if (!is_scene_selected(scenes[i]->name, BACKEND_NAME))
         {
-            return false;
+            continue;
+        }
+
+        if (!run_scene(scenes[i], NULL))
+        {
+            success = false;
+            break;
         }
         else if (sigint_triggered)
         {
-            return true;
+            break;
+        }
+    }
+
+    end_scenes();
+
+    return success;
+}
+
+size_t get_scene_count()
+{
+    return scenes_count;
+}
+
+const char *get_scene_name(size_t index)
+{
+    return scenes[index]->name;
+}
+
+bool run_scene_at(size_t index)
+{
+    return run_scene(scenes[index], NULL);
+}
+
+// Sets up what is shared by all scenes of a run
+bool begin_scenes()
+{
+#ifndef NIGHTMARE_USE_GLES2
+    if (options.antialiasing == ANTIALIASING_SHADER)
+    {
+        print_error("Shader antialiasing requires GLES2\n");
+        return false;
+    }
+
+    if (options.line_mode == LINE_MODE_SHADER)
+    {
+        print_error("Shader expanded lines require GLES2\n");
+        return false;
+    }
+#endif
+
+    if (options.load_lines > 0)
+    {
+        for (size_t i = 0; i < scenes_count; i++)
+        {
+            if (scenes[i]->set_load)
+            {
+                scenes[i]->set_load(options.load_lines, options.load_points);
+            }
+        }
+    }
+
+    // Drivers silently clamp the width of line strips
+    GLfloat line_width_range[2];
+    glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, line_width_range);
+    if (options.line_mode == LINE_MODE_STRIP && options.line_width > line_width_range[1])
+    {
+        print("Line strips are at most %.1f px wide on this driver, expanded lines (--lines) draw %.1f px\n\n",
+              line_width_range[1], options.line_width);
+    }
+
+    render_scaled = options.render_scale < 1.0f;
+    if (render_scaled && !initialize_render_scale(options.render_scale))
+    {
+        print_error("Failed to initialize render scaling\n");
+        return false;
+    }
+
+    if (options.partial_update && render_scaled)
+    {
+        print("Partial update is not supported together with render scaling, falling back to full redraws\n\n");
+    }
+    else if (options.partial_update)
+    {
+        partial_update_supported = egl_initialize_partial_update();
+        if (!partial_update_supported)
+        {
+            print("Partial update is not supported, falling back to full redraws\n\n");
         }
     }
 
     return true;
 }
 
-static bool run_scene(struct Scene *scene)
+void end_scenes()
+{
+    if (render_scaled)
+    {
+        cleanup_render_scale();
+        render_scaled = false;
+    }
+}
+
+bool run_config_sweep()
+{
+    EGLConfig *configs;
+    EGLint config_count;
+    if (!egl_get_configs(&configs, &config_count))
+    {
+        return false;
+    }
+
+    print("Sweeping %i framebuffer configurations\n\n", config_count);
+
+    // The initial surface is replaced by one per configuration
+    egl_destroy_surface();
+
+    bool success = true;
+    for (EGLint i = 0; i < config_count && !sigint_triggered; i++)
+    {
+        if (!egl_create_surface(configs[i]))
+        {
+            print_error("Failed to create surface for framebuffer configuration, skipping it\n\n");
+            egl_destroy_surface();
+            continue;
+        }
+
+        const struct EglConfigInfo *config = &egl_config_info;
+        print("config 0x%x: RGBA %i/%i/%i/%i, depth %i, stencil %i, samples %i\n\n",
+              config->id, config->red_size, config->green_size, config->blue_size, config->alpha_size,
+              config->depth_size, config->stencil_size, config->samples);
+
+        if (!run_scenes())
+        {
+            success = false;
+            break;
+        }
+
+        egl_destroy_surface();
+    }
+
+    free(configs);
+
+    return success;
+}
+
+bool run_antialiasing_sweep()
+{
+    bool success = true;
+    for (int i = 0; i < ANTIALIASING_COUNT && !sigint_triggered; i++)
+    {
+        options.antialiasing = (enum Antialiasing)i;
+
+#ifndef NIGHTMARE_USE_GLES2
+        if (options.antialiasing == ANTIALIASING_SHADER)
+        {
+            print("Skipping antialiasing mode '%s', it requires GLES2\n\n", get_antialiasing_name(options.antialiasing));
+            continue;
+        }
+#endif
+
+        // Multisampling needs a matching framebuffer configuration
+        if (!egl_recreate_surface())
+        {
+            print_error("Failed to create surface for antialiasing mode '%s', skipping it\n\n", get_antialiasing_name(options.antialiasing));
+            continue;
+        }
+
+        print("antialiasing '%s' (config 0x%x, samples %i)\n\n",
+              get_antialiasing_name(options.antialiasing), egl_config_info.id, egl_config_info.samples);
+
+        if (!run_scenes())
+        {
+            success = false;
+            break;
+        }
+    }
+
+    return success;
+}
+
+bool run_line_sweep()
+{
+    bool success = true;
+    for (int i = 0; i < LINE_MODE_COUNT && !sigint_triggered; i++)
+    {
+        options.line_mode = (enum LineMode)i;
+
+#ifndef NIGHTMARE_USE_GLES2
+        if (options.line_mode == LINE_MODE_SHADER)
+        {
+            print("Skipping line mode '%s', it requires GLES2\n\n", get_line_mode_name(options.line_mode));
+            continue;
+        }
+#endif
+
+        print("line mode '%s' (%s joins, width %.1f px)\n\n",
+              get_line_mode_name(options.line_mode), get_line_join_name(options.line_join), options.line_width);
+
+        if (!run_scenes())
+        {
+            success = false;
+            break;
+        }
+    }
+
+    return success;
+}
+
+bool run_capacity_search()
 {
-    print("run scene '%s'\n", scene->name);
+    if (!begin_scenes())
+    {
+        return false;
+    }
 
-    if (!scene->initialize())
+    // Every probe needs the same amount of frames to be comparable
+    int frame_count = options.frame_count;
+    if (options.frame_count == 0)
+    {
+        options.frame_count = CAPACITY_PROBE_FRAMES;
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < scenes_count && !sigint_triggered; i++)
+    {
+        if (!is_scene_selected(scenes[i]->name, BACKEND_NAME))
+        {
+            continue;
+        }
+
+        if (!scenes[i]->set_load)
+        {
+            print("Scene '%s' has no adjustable load, skipping it\n\n", scenes[i]->name);
+            continue;
+        }
+
+        if (scenes[i]->is_supported && !scenes[i]->is_supported())
+        {
+            print("Scene '%s' is not supported by the %s driver, skipping it\n\n", scenes[i]->name, BACKEND_NAME);
+            continue;
+        }
+
+        if (!search_capacity(scenes[i]))
+        {
+            success = false;
+            break;
+        }
+    }
+
+    options.frame_count = frame_count;
+    end_scenes();
+
+    return success;
+}
+
+// Doubles the line count until the p99 frame time misses the budget, then
+// bisects between the largest passing and the smallest failing probe. Assumes
+// the frame time grows monotonically with the load.
+static bool search_capacity(struct Scene *scene)
+{
+    size_t default_lines, default_points;
+    scene->get_load(&default_lines, &default_points);
+
+    size_t points = options.capacity_points > 0 ? (size_t)options.capacity_points : default_points;
+    double budget_ms = 1000.0 / options.target_fps;
+
+    print("Capacity search for '%s': %zu points per line, p99 frame time budget %.3f ms (%.1f FPS)\n\n",
+          scene->name, points, budget_ms, options.target_fps);
+
+    // Largest line count known to meet the budget and smallest one known to miss it (0 if unknown)
+    size_t sustained = 0;
+    size_t exceeded = 0;
+    size_t lines = default_lines;
+    bool success = true;
+
+    while (!sigint_triggered)
+    {
+        double p99_ms;
+        scene->set_load(lines, points);
+        if (!run_scene(scene, &p99_ms))
+        {
+            success = false;
+            break;
+        }
+
+        bool met = p99_ms <= budget_ms;
+        print("Probe %zu lines x %zu points: p99 %.3f ms, %s\n\n", lines, points, p99_ms, met ? "within budget" : "over budget");
+
+        if (met)
+        {
+            sustained = lines;
+        }
+        else
+        {
+            exceeded = lines;
+        }
+
+        if (exceeded == 0)
+        {
+            if (lines >= MAX_CAPACITY_LINES)
+            {
+                break;
+            }
+
+            lines = lines * 2 < MAX_CAPACITY_LINES ? lines * 2 : MAX_CAPACITY_LINES;
+        }
+        else
+        {
+            // Stop at a resolution of about 3 percent
+            size_t resolution = sustained / 32 > 1 ? sustained / 32 : 1;
+            if (exceeded - sustained <= resolution)
+            {
+                break;
+            }
+
+            lines = sustained + (exceeded - sustained) / 2;
+        }
+    }
+
+    scene->set_load(default_lines, default_points);
+
+    if (!success)
     {
-        print_error("Failed to initialize EGL\n");
         return false;
     }
 
+    if (sustained == 0)
+    {
+        print("Capacity of '%s': even a single line misses the budget\n", scene->name);
+    }
+    else
+    {
+        print("Capacity of '%s': %zu lines x %zu points (%zu points) at %.1f FPS%s\n",
+              scene->name, sustained, points, sustained * points, options.target_fps,
+              exceeded == 0 ? ", limited by the search range" : "");
+    }
+    print("---\n\n");
+
+    struct SceneResult result = {
+        .scene_name = scene->name,
+        .backend = BACKEND_NAME,
+        .config = egl_config_info,
+        .render_scale = options.render_scale,
+        .antialiasing = options.antialiasing,
+        .line_mode = options.line_mode,
+        .line_join = options.line_join,
+        .line_width = options.line_width,
+    };
+    result_add_parameter(&result, "target_fps", options.target_fps);
+    result_add_parameter(&result, "point_count", points);
+    result_add_metric(&result, "capacity_lines", sustained);
+    result_add_metric(&result, "capacity_points", sustained * points);
+    results_add(&result);
+
+    return true;
+}
+
+// The 99th percentile of the frame time is stored to p99_ms if given
+static bool run_scene(struct Scene *scene, double *p99_ms)
+{
+    if (scene->is_supported && !scene->is_supported())
+    {
+        print("Scene '%s' is not supported by the %s driver, skipping it\n\n", scene->name, BACKEND_NAME);
+        return true;
+    }
+
+    if (options.line_mode != LINE_MODE_STRIP && !scene->thick_lines)
+    {
+        print("Scene '%s' only draws line strips, skipping it for line mode '%s'\n\n", scene->name, get_line_mode_name(options.line_mode));
+        return true;
+    }
+
+    // Its results would be labelled with an antialiasing it does not draw
+    if (options.antialiasing == ANTIALIASING_SHADER && !scene->thick_lines)
+    {
+        print("Scene '%s' does not draw antialiasing mode '%s', skipping it\n\n", scene->name, get_antialiasing_name(options.antialiasing));
+        return true;
+    }
+
+    print("run scene '%s' (%s)\n", scene->name, BACKEND_NAME);
+
+    struct TraceSpan scene_span = trace_begin(scene->name);
+
+    uint64_t resources_mark = get_gl_resources_mark();
+    int64_t resident_before = get_resident_memory_kib();
+
+    startup_stage_finished("prepare scene");
+
+    bool success = true;
+    struct FrameSamples frame_samples = {NULL, 0, 0};
+    struct SensorSamples sensor_samples = {NULL, 0, 0};
+
+    struct ProgramCacheStatistics cache_before = program_cache_statistics;
+    struct timespec initialize_started, initialize_finished;
+    clock_gettime(CLOCK_MONOTONIC, &initialize_started);
+
+    struct TraceSpan initialize_span = trace_begin("initialize");
+    bool initialized = scene->initialize();
+    trace_end(&initialize_span);
+
+    // Include work drivers defer until the first use
+    glFinish();
+    clock_gettime(CLOCK_MONOTONIC, &initialize_finished);
+    double initialize_time = difftimespec_ns(initialize_finished, initialize_started) / 1e6;
+    startup_stage_finished("scene initialize");
+
+    if (!initialized)
+    {
+        print_error("Failed to initialize scene '%s'\n", scene->name);
+        success = false;
+        goto finish;
+    }
+
+    print("Initialize = %.3f ms", initialize_time);
+    if (is_program_cache_enabled())
+    {
+        uint64_t hits = program_cache_statistics.hits - cache_before.hits;
+        uint64_t misses = program_cache_statistics.misses - cache_before.misses;
+        print(" (%s, program cache: %llu hits, %llu misses)", misses == 0 && hits > 0 ? "warm" : "cold",
+              (unsigned long long)hits, (unsigned long long)misses);
+    }
+    print("\n");
+
+    if (scene->decimates && is_decimation_active())
+    {
+        print("Decimation = %s, %zu points per line\n", get_decimation_name(options.decimation), get_decimated_capacity());
+    }
+
+    bool partial_update = partial_update_supported && scene->reports_damage;
+    uint64_t idle_frames = 0;
+    uint64_t repainted_pixels = 0;
+    damage_reset();
+
+    uint64_t scale_samples = 0;
+    int64_t scene_time_ns = 0;
+    int64_t upscale_time_ns = 0;
+
+    uint32_t perf_counters = get_perf_counter_mask();
+    uploaded_bytes = 0;
+    draw_calls = 0;
+    struct PerfCounterValues before_update, after_update, after_draw;
+
+    if (are_sensors_enabled())
+    {
+        sensors_begin_recording();
+    }
+
+    size_t surface_count = egl_get_surface_count();
+    int64_t surface_time_ns[MAX_SURFACES] = {0};
+
+    // On demand, only frames in which the scene changed are drawn
+    bool on_demand = options.on_demand && scene->is_dirty;
+    int64_t busy_ns = 0;
+    int64_t total_latency_ns = 0;
+    int64_t max_latency_ns = 0;
+    struct rusage usage_before, usage_after;
+    getrusage(RUSAGE_SELF, &usage_before);
+
     struct timespec started;
     struct timespec last;
     uint64_t frames = 0;
+    // Other processes of the harness start the scene at the same time
+    synchronize_harness();
     clock_gettime(CLOCK_MONOTONIC, &started);
     last = started;
+    int64_t started_ns = timespec_to_ns(started);
+    int64_t frame_period_ns = options.max_fps > 0.0f ? SEC_IN_NS / options.max_fps : 0;
+    int64_t next_frame_ns = started_ns;
+    // Time at which the scene was due to change
+    int64_t change_due_ns = started_ns;
 
     // Mainloop
-    while (difftimespec_ns(last, started) < 15 * SEC_IN_NS)
+    while (options.frame_count > 0 ? frames < (uint64_t)options.frame_count
+                                   : difftimespec_ns(last, started) < SCENE_DURATION_NS)
     {
         frames++;
+        struct TraceSpan frame_span = trace_begin("frame");
+
+        // Handle X11 events and signals which arrived while drawing
+        dispatch_events();
 
         // Check SIGINT
         if (sigint_triggered)
         {
+            trace_end(&frame_span);
             goto finish;
         }
 
-        // Run any EGL specific mainloop tasks
-        egl_loop_step();
-
         // Calculate time delta
         struct timespec current;
         clock_gettime(CLOCK_MONOTONIC, &current);
-        int64_t delta_ns = difftimespec_ns(current, last);
+        int64_t delta_ns = options.frame_count > 0 ? (int64_t)FIXED_TIME_STEP_NS : difftimespec_ns(current, last);
         last = current;
 
+        if (perf_counters)
+        {
+            read_perf_counters(&before_update);
+        }
+
         // Update scene
+        struct TraceSpan update_span = trace_begin("update");
         scene->update(delta_ns);
+        trace_end(&update_span);
+
+        if (perf_counters)
+        {
+            read_perf_counters(&after_update);
+        }
 
         // Draw scene
-        scene->draw();
-        eglSwapBuffers(egl_display, egl_surface);
+        bool redraw = !on_demand || scene->is_dirty();
+        if (!redraw)
+        {
+            idle_frames++;
+        }
+        else if (partial_update)
+        {
+            if (!draw_damaged(scene, &repainted_pixels))
+            {
+                idle_frames++;
+            }
+        }
+        else
+        {
+            // Surfaces are drawn one after another, all of them show the same scene state
+            for (size_t surface = 0; surface < surface_count; surface++)
+            {
+                struct timespec surface_started, surface_finished;
+                clock_gettime(CLOCK_MONOTONIC, &surface_started);
+
+                if (surface_count > 1 && !egl_select_surface(surface))
+                {
+                    success = false;
+                    trace_end(&frame_span);
+                    goto finish;
+                }
+
+                if (render_scaled)
+                {
+                    if (frames % RENDER_SCALE_SAMPLE_INTERVAL == 0)
+                    {
+                        struct timespec draw_started, draw_finished, upscale_finished;
+
+                        glFinish();
+                        clock_gettime(CLOCK_MONOTONIC, &draw_started);
+
+                        render_scale_begin_frame();
+                        draw_scene(scene);
+                        glFinish();
+                        clock_gettime(CLOCK_MONOTONIC, &draw_finished);
+
+                        present_render_scale();
+                        glFinish();
+                        clock_gettime(CLOCK_MONOTONIC, &upscale_finished);
+
+                        scene_time_ns += difftimespec_ns(draw_finished, draw_started);
+                        upscale_time_ns += difftimespec_ns(upscale_finished, draw_finished);
+                        scale_samples++;
+                    }
+                    else
+                    {
+                        render_scale_begin_frame();
+                        draw_scene(scene);
+                        present_render_scale();
+                    }
+
+                    swap_buffers();
+                }
+                else
+                {
+                    draw_scene(scene);
+                    swap_buffers();
+                }
+
+                clock_gettime(CLOCK_MONOTONIC, &surface_finished);
+                surface_time_ns[surface] += difftimespec_ns(surface_finished, surface_started);
+            }
+        }
+
+        if (!is_startup_finished())
+        {
+            finish_startup_profile();
+        }
+
+        // Serializing is cheap at on-demand frame rates and bounds the GPU busy time from above
+        if (on_demand && redraw)
+        {
+            struct timespec presented;
+            glFinish();
+            clock_gettime(CLOCK_MONOTONIC, &presented);
+
+            int64_t latency_ns = timespec_to_ns(presented) - change_due_ns;
+            busy_ns += difftimespec_ns(presented, current);
+            total_latency_ns += latency_ns;
+            max_latency_ns = latency_ns > max_latency_ns ? latency_ns : max_latency_ns;
+        }
+
+        // The draw phase includes presenting the frame
+        struct FrameSample sample = {0};
+        if (perf_counters)
+        {
+            read_perf_counters(&after_draw);
+            subtract_perf_counters(&after_update, &before_update, &sample.update_counters);
+            subtract_perf_counters(&after_draw, &after_update, &sample.draw_counters);
+        }
+
+        struct timespec frame_finished;
+        clock_gettime(CLOCK_MONOTONIC, &frame_finished);
+        sample.frame_ns = difftimespec_ns(frame_finished, current);
+        sample.started_ns = (int64_t)current.tv_sec * SEC_IN_NS + current.tv_nsec;
+        if (redraw)
+        {
+            frame_samples_append(&frame_samples, &sample);
+        }
+
+        trace_end(&frame_span);
+
+        // Block until the scene changes next or the next frame is due, fixed time steps do not wait
+        int64_t finished_ns = timespec_to_ns(frame_finished);
+        change_due_ns = finished_ns;
+        if (options.frame_count == 0)
+        {
+            int64_t wait_ns = on_demand && scene->get_next_change ? scene->get_next_change() : 0;
+
+            // A late frame moves the frame grid instead of rushing the following frames
+            if (frame_period_ns > 0)
+            {
+                next_frame_ns = next_frame_ns + frame_period_ns > finished_ns ? next_frame_ns + frame_period_ns : finished_ns;
+                wait_ns = next_frame_ns - finished_ns > wait_ns ? next_frame_ns - finished_ns : wait_ns;
+            }
+
+            int64_t remaining_ns = started_ns + SCENE_DURATION_NS - finished_ns;
+            wait_ns = wait_ns < remaining_ns ? wait_ns : remaining_ns;
+            if (wait_ns > 0)
+            {
+                change_due_ns = finished_ns + wait_ns;
+
+                struct TraceSpan wait_span = trace_begin("wait");
+                wait_for_deadline(change_due_ns);
+                trace_end(&wait_span);
+            }
+        }
     }
 
     struct timespec stopped;
     clock_gettime(CLOCK_MONOTONIC, &stopped);
+    getrusage(RUSAGE_SELF, &usage_after);
     double elapsed_time = ((double)difftimespec_ns(stopped, started)) / 1e9;
-    double fps = ((double)frames) / elapsed_time;
+    uint64_t presented_frames = frames - idle_frames;
+    double fps = ((double)(on_demand ? presented_frames : frames)) / elapsed_time;
+    double cpu_time = (usage_after.ru_utime.tv_sec - usage_before.ru_utime.tv_sec) +
+                      (usage_after.ru_stime.tv_sec - usage_before.ru_stime.tv_sec) +
+                      ((usage_after.ru_utime.tv_usec - usage_before.ru_utime.tv_usec) +
+                       (usage_after.ru_stime.tv_usec - usage_before.ru_stime.tv_usec)) / 1e6;
 
     print("Average FPS = %f\n", fps);
-    print("---\n\n");
+    print("CPU utilisation = %.1f%%\n", cpu_time / elapsed_time * 100.0);
+    print("Uploaded data = %.1f KiB per frame\n", frames > 0 ? (double)uploaded_bytes / frames / 1024.0 : 0.0);
+    if (draw_calls > 0)
+    {
+        print("Draw calls = %.1f per frame\n", (double)draw_calls / frames);
+    }
+
+    double decimation_error = 0.0;
+    bool decimation_checked = options.decimation_check && scene->decimates && is_decimation_active() &&
+                              measure_decimation_error(scene, &decimation_error);
+    if (decimation_checked)
+    {
+        print("Decimation error = %.3f%% of the pixels differ from the undecimated lines\n", decimation_error);
+    }
+
+    size_t throttled_frames = 0;
+    if (are_sensors_enabled())
+    {
+        sensors_end_recording(&sensor_samples);
+        throttled_frames = flag_throttled_frames(&frame_samples, &sensor_samples);
+    }
+
+    double frame_p99_ms = get_frame_percentile_ms(&frame_samples, 99.0);
+    if (p99_ms)
+    {
+        (*p99_ms) = frame_p99_ms;
+    }
+
+    struct SceneResult result = {
+        .scene_name = scene->name,
+        .backend = BACKEND_NAME,
+        .config = egl_config_info,
+        .frames = frames,
+        .elapsed_time = elapsed_time,
+        .fps = fps,
+        .render_scale = options.render_scale,
+        .antialiasing = options.antialiasing,
+        .line_mode = options.line_mode,
+        .line_join = options.line_join,
+        .line_width = options.line_width,
+        .decimation = scene->decimates ? options.decimation : DECIMATION_NONE,
+        .initialize_time = initialize_time,
+        .perf_counters = perf_counters,
+        .frame_samples = frame_samples,
+        .sensor_samples = sensor_samples,
+        .scene_time = scale_samples > 0 ? (double)scene_time_ns / scale_samples / 1e6 : 0.0,
+        .upscale_time = scale_samples > 0 ? (double)upscale_time_ns / scale_samples / 1e6 : 0.0,
+    };
+    result_add_metric(&result, "frame_p99_ms", frame_p99_ms);
+    result_add_metric(&result, "uploaded_bytes_per_frame", frames > 0 ? (double)uploaded_bytes / frames : 0.0);
+    if (draw_calls > 0)
+    {
+        result_add_metric(&result, "draw_calls_per_frame", (double)draw_calls / frames);
+    }
+    if (decimation_checked)
+    {
+        result_add_metric(&result, "decimation_error_percent", decimation_error);
+    }
+    result_add_metric(&result, "cpu_percent", cpu_time / elapsed_time * 100.0);
+    if (on_demand)
+    {
+        result_add_metric(&result, "wakeups_per_second", frames / elapsed_time);
+        result_add_metric(&result, "gpu_busy_percent", busy_ns / 1e9 / elapsed_time * 100.0);
+        result_add_metric(&result, "visual_latency_ms", presented_frames > 0 ? total_latency_ns / 1e6 / presented_frames : 0.0);
+        result_add_metric(&result, "visual_max_latency_ms", max_latency_ns / 1e6);
+    }
+    if (options.max_fps > 0.0f)
+    {
+        result_add_parameter(&result, "max_fps", options.max_fps);
+    }
+    if (surface_count > 1)
+    {
+        result_add_parameter(&result, "mirror_surfaces", surface_count);
+        result_add_metric(&result, "aggregate_fps", presented_frames * surface_count / elapsed_time);
+        for (size_t surface = 0; surface < surface_count; surface++)
+        {
+            result_add_metric(&result, surface_metric_names[surface],
+                              presented_frames > 0 ? surface_time_ns[surface] / 1e6 / presented_frames : 0.0);
+        }
+    }
+    if (scene->get_load)
+    {
+        size_t line_count, point_count;
+        scene->get_load(&line_count, &point_count);
+        result_add_parameter(&result, "line_count", line_count);
+        result_add_parameter(&result, "point_count", point_count);
+    }
+
+    struct SensorSummary sensor_summary;
+    if (are_sensors_enabled())
+    {
+        get_sensor_summary(&sensor_samples, &sensor_summary);
+        result_add_metric(&result, "throttled_frames", throttled_frames);
+        if (sensor_summary.max_temperature_mc >= 0)
+        {
+            result_add_metric(&result, "max_temperature_c", sensor_summary.max_temperature_mc / 1e3);
+        }
+        if (sensor_summary.min_cpu_khz >= 0)
+        {
+            result_add_metric(&result, "min_cpu_mhz", sensor_summary.min_cpu_khz / 1e3);
+        }
+        if (sensor_summary.min_devfreq_hz >= 0)
+        {
+            result_add_metric(&result, "min_devfreq_mhz", sensor_summary.min_devfreq_hz / 1e6);
+        }
+    }
+
+    struct IngestStatistics ingest = {0};
+    bool ingesting = get_ingest_statistics(&ingest);
+    double ingest_latency_ms = ingest.received > 0 ? (double)ingest.total_latency_ns / ingest.received / 1e6 : 0.0;
+    if (ingesting)
+    {
+        result_add_metric(&result, "ingested_samples_per_second", ingest.received / elapsed_time);
+        result_add_metric(&result, "ingest_max_batch", ingest.max_batch);
+        result_add_metric(&result, "ingest_skipped", ingest.skipped);
+        result_add_metric(&result, "ingest_dropped", ingest.dropped);
+        result_add_metric(&result, "ingest_latency_ms", ingest_latency_ms);
+        result_add_metric(&result, "ingest_max_latency_ms", ingest.max_latency_ns / 1e6);
+    }
+
+    if (results_add(&result))
+    {
+        // Owned by the results now
+        frame_samples.samples = NULL;
+        sensor_samples.samples = NULL;
+    }
+
+    if (are_sensors_enabled())
+    {
+        print("Throttled frames = %zu (%.1f%%)\n", throttled_frames, frames > 0 ? throttled_frames * 100.0 / frames : 0.0);
+        if (sensor_summary.max_temperature_mc >= 0)
+        {
+            print("Maximum temperature = %.1f C\n", sensor_summary.max_temperature_mc / 1e3);
+        }
+        if (sensor_summary.min_cpu_khz >= 0)
+        {
+            print("Minimum CPU frequency = %.0f MHz\n", sensor_summary.min_cpu_khz / 1e3);
+        }
+        if (sensor_summary.min_devfreq_hz >= 0)
+        {
+            print("Minimum devfreq frequency = %.0f MHz\n", sensor_summary.min_devfreq_hz / 1e6);
+        }
+    }
+
+    if (ingesting)
+    {
+        print("Ingested = %.1f samples/s (at most %llu per frame, %llu skipped, %llu dropped by the producer)\n",
+              ingest.received / elapsed_time, (unsigned long long)ingest.max_batch,
+              (unsigned long long)ingest.skipped, (unsigned long long)ingest.dropped);
+        print("Ingest latency = %.3f ms average, %.3f ms maximum\n", ingest_latency_ms, ingest.max_latency_ns / 1e6);
+    }
+
+    if (perf_counters)
+    {
+        struct PerfCounterValues update_average, draw_average;
+        get_average_perf_counters(&result, &update_average, &draw_average);
+        print_perf_counters("update", &update_average, perf_counters);
+        print_perf_counters("draw", &draw_average, perf_counters);
+    }
+
+    if (render_scaled)
+    {
+        print("Render resolution = %ix%i (scale %.2f)\n", render_width, render_height, options.render_scale);
+        print("Scene rendering = %.3f ms, upscale pass = %.3f ms (%llu sampled frames)\n",
+              result.scene_time, result.upscale_time, (unsigned long long)scale_samples);
+    }
+
+    if (surface_count > 1)
+    {
+        print("Mirrored surfaces = %zu, aggregate FPS = %f\n", surface_count, presented_frames * surface_count / elapsed_time);
+        for (size_t surface = 0; surface < surface_count; surface++)
+        {
+            print("Surface %zu = %.3f ms per frame\n", surface,
+                  presented_frames > 0 ? surface_time_ns[surface] / 1e6 / presented_frames : 0.0);
+        }
+    }
+
+    if (on_demand)
+    {
+        print("Presented frames = %llu of %llu wakeups (%.1f wakeups per second)\n", (unsigned long long)presented_frames,
+              (unsigned long long)frames, frames / elapsed_time);
+        print("GPU busy = %.2f%%, visual latency = %.3f ms average, %.3f ms maximum\n", busy_ns / 1e9 / elapsed_time * 100.0,
+              presented_frames > 0 ? total_latency_ns / 1e6 / presented_frames : 0.0, max_latency_ns / 1e6);
+    }
+
+    if (partial_update)
+    {
+        double screen_pixels = (double)screen_width * (double)screen_height;
+        double repainted = presented_frames > 0 ? (double)repainted_pixels / (presented_frames * screen_pixels) : 0.0;
+
+        print("Presented frames = %llu (%llu without damage)\n", (unsigned long long)presented_frames, (unsigned long long)idle_frames);
+        print("Average repainted area = %.1f%%\n", repainted * 100.0);
+    }
+
+    for (size_t surface = 0; options.verify_output && surface < surface_count; surface++)
+    {
+        if (surface_count > 1 && !egl_select_surface(surface))
+        {
+            success = false;
+        }
+        else if (is_output_blank())
+        {
+            print_error("Scene '%s' rendered a blank frame on surface %zu\n", scene->name, surface);
+            success = false;
+        }
+    }
 
 finish:
+    frame_samples_free(&frame_samples);
+    sensor_samples_free(&sensor_samples);
+    glDisable(GL_SCISSOR_TEST);
+
+    struct TraceSpan deinitialize_span = trace_begin("deinitialize");
     scene->deinitialize();
+    trace_end(&deinitialize_span);
+
+    // Whatever the scene did not clean up would distort the following scenes
+    size_t leaked_resources = release_gl_resources(resources_mark);
+    size_t leaked_states = reset_gl_state();
+    glFinish();
+
+    int64_t resident_after = get_resident_memory_kib();
+    if (leaked_resources > 0 || leaked_states > 0)
+    {
+        print_error("Scene '%s' leaked %zu GL objects and %zu GL states\n", scene->name, leaked_resources, leaked_states);
+    }
+
+    if (resident_before >= 0 && resident_after >= 0)
+    {
+        print("Resident memory growth after teardown = %lld KiB\n", (long long)(resident_after - resident_before));
+    }
+
+    print("---\n\n");
+
+    trace_end(&scene_span);
+    return success;
+}
+
+void add_uploaded_bytes(size_t bytes)
+{
+    uploaded_bytes += bytes;
+}
+
+void add_draw_calls(size_t count)
+{
+    draw_calls += count;
+}
+
+static void draw_scene(struct Scene *scene)
+{
+    struct TraceSpan span = trace_begin("draw");
+    scene->draw();
+    trace_end(&span);
+}
+
+static void present_render_scale()
+{
+    struct TraceSpan span = trace_begin("upscale");
+    render_scale_present();
+    trace_end(&span);
+}
+
+static void swap_buffers()
+{
+    struct TraceSpan span = trace_begin("swap");
+    if (egl_is_offscreen())
+    {
+        // Swapping a pbuffer does nothing, wait for the frame so frames do not queue up unbounded
+        glFinish();
+    }
+    else
+    {
+        eglSwapBuffers(egl_display, egl_surface);
+    }
+    trace_end(&span);
+}
+
+// True if every pixel of the surface has the same colour
+static bool is_output_blank()
+{
+    size_t pixel_count = (size_t)screen_width * (size_t)screen_height;
+    uint32_t *pixels = malloc(pixel_count * sizeof(uint32_t));
+    if (!pixels)
+    {
+        return false;
+    }
+
+    glReadPixels(0, 0, screen_width, screen_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    bool blank = true;
+    for (size_t i = 1; i < pixel_count && blank; i++)
+    {
+        blank = pixels[i] == pixels[0];
+    }
+
+    free(pixels);
+
+    return blank;
+}
+
+// Draws the current frame of the scene for a comparison
+static void draw_comparison_frame(struct Scene *scene)
+{
+    if (render_scaled)
+    {
+        render_scale_begin_frame();
+        draw_scene(scene);
+        present_render_scale();
+    }
+    else
+    {
+        draw_scene(scene);
+    }
+}
+
+// Percentage of the pixels which differ between the decimated lines and all
+// of their samples, drawn from the same scene state
+static bool measure_decimation_error(struct Scene *scene, double *percent)
+{
+    size_t pixel_count = (size_t)screen_width * (size_t)screen_height;
+    uint32_t *decimated = malloc(pixel_count * sizeof(uint32_t));
+    uint32_t *undecimated = malloc(pixel_count * sizeof(uint32_t));
+    if (!decimated || !undecimated)
+    {
+        print_error("Failed to allocate memory for the decimation check\n");
+        free(decimated);
+        free(undecimated);
+        return false;
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+
+    draw_comparison_frame(scene);
+    glReadPixels(0, 0, screen_width, screen_height, GL_RGBA, GL_UNSIGNED_BYTE, decimated);
+
+    set_decimation_bypass(true);
+    draw_comparison_frame(scene);
+    glReadPixels(0, 0, screen_width, screen_height, GL_RGBA, GL_UNSIGNED_BYTE, undecimated);
+    set_decimation_bypass(false);
+
+    size_t differing = 0;
+    for (size_t i = 0; i < pixel_count; i++)
+    {
+        for (int channel = 0; channel < 3; channel++)
+        {
+            int a = (decimated[i] >> (channel * 8)) & 0xff;
+            int b = (undecimated[i] >> (channel * 8)) & 0xff;
+            if (abs(a - b) > DECIMATION_CHANNEL_TOLERANCE)
+            {
+                differing++;
+                break;
+            }
+        }
+    }
+    (*percent) = pixel_count > 0 ? differing * 100.0 / pixel_count : 0.0;
+
+    free(decimated);
+    free(undecimated);
+
+    return true;
+}
+
+// Redraws only the region which is outdated in the current back buffer.
+// Returns false if nothing changed and therefore no frame has been presented.
+static bool draw_damaged(struct Scene *scene, uint64_t *repainted_pixels)
+{
+    if (damage_is_empty())
+    {
+        return false;
+    }
+
+    struct DamageRect region;
+    if (damage_get_repaint_region(egl_query_buffer_age(), &region))
+    {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(region.x, region.y, region.width, region.height);
+    }
+    else
+    {
+        // Back buffer content is unknown
+        struct DamageRect full = {0, 0, screen_width, screen_height};
+        region = full;
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    EGLint region_rect[4] = {region.x, region.y, region.width, region.height};
+    egl_set_damage_region(region_rect, 1);
+
+    draw_scene(scene);
+
+    struct DamageRect damage = damage_get_current();
+    EGLint damage_rect[4] = {damage.x, damage.y, damage.width, damage.height};
+    struct TraceSpan swap_span = trace_begin("swap");
+    egl_swap_buffers_with_damage(damage_rect, 1);
+    trace_end(&swap_span);
+
+    damage_finish_frame();
+
+    (*repainted_pixels) += (uint64_t)region.width * (uint64_t)region.height;
+
     return true;
-}
\ No newline at end of file
+}
+
+// Prints the per frame averages of a phase
+static void print_perf_counters(const char *phase, const struct PerfCounterValues *values, uint32_t mask)
+{
+    print("Counters per frame (%s):", phase);
+    for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+    {
+        if (mask & (1u << c))
+        {
+            print(" %s=%llu", get_perf_counter_name(c), (unsigned long long)values->values[c]);
+        }
+    }
+
+    uint32_t ipc_mask = (1u << PERF_COUNTER_CYCLES) | (1u << PERF_COUNTER_INSTRUCTIONS);
+    if ((mask & ipc_mask) == ipc_mask && values->values[PERF_COUNTER_CYCLES] > 0)
+    {
+        print(" IPC=%.2f", (double)values->values[PERF_COUNTER_INSTRUCTIONS] / values->values[PERF_COUNTER_CYCLES]);
+    }
+
+    uint32_t miss_mask = (1u << PERF_COUNTER_CACHE_REFERENCES) | (1u << PERF_COUNTER_CACHE_MISSES);
+    if ((mask & miss_mask) == miss_mask && values->values[PERF_COUNTER_CACHE_REFERENCES] > 0)
+    {
+        print(" miss-rate=%.1f%%", 100.0 * values->values[PERF_COUNTER_CACHE_MISSES] / values->values[PERF_COUNTER_CACHE_REFERENCES]);
+    }
+
+    print("\n");
+}
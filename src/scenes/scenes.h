@@ -3,16 +3,47 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 struct Scene
 {
     const char *name;
+    // Whether update() reports what changed via the damage module
+    bool reports_damage;
+    // Whether draw() honours the line mode and shader antialiasing (scenes without only draw GL_LINE_STRIP)
+    bool thick_lines;
+    // Whether the scene reduces its lines with the decimation of the options
+    bool decimates;
+    // Whether the driver provides what the scene needs (optional, called with a current context)
+    bool (*is_supported)();
     bool (*initialize)();
     void (*update)(int64_t delta_ns);
     void (*draw)();
+    // Also called after initialize() failed, it has to handle whatever was set up until then
     void (*deinitialize)();
+    // Whether the last update() changed what draw() shows (optional, scenes without always redraw)
+    bool (*is_dirty)();
+    // Time until the scene changes by itself, 0 while it animates (optional)
+    int64_t (*get_next_change)();
+    // Number of lines and points per line, takes effect on the next initialize()
+    void (*set_load)(size_t line_count, size_t point_count);
+    void (*get_load)(size_t *line_count, size_t *point_count);
 };
 
 bool run_scenes();
+size_t get_scene_count();
+const char *get_scene_name(size_t index);
+bool begin_scenes();
+bool run_scene_at(size_t index);
+void end_scenes();
+bool run_config_sweep();
+bool run_antialiasing_sweep();
+bool run_line_sweep();
+bool run_capacity_search();
+
+// Scenes report the vertex and texture data they hand to GL while drawing
+void add_uploaded_bytes(size_t bytes);
+// Scenes which count their draw calls report them per frame
+void add_draw_calls(size_t count);
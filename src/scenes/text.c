@@ -0,0 +1,528 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "text.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "egl.h"
+#include "data-source.h"
+#include "scenes.h"
+#include "options.h"
+#include "trace.h"
+#include "gl-resources.h"
+
+#ifdef NIGHTMARE_USE_GLES1
+#include <GLES/gl.h>
+#elif defined NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+#endif
+
+/*
+ * Text
+ *
+ * A grid of labels, each the name of a channel and a numeric readout of its
+ * latest sample, like the axis labels and live values of a dashboard. The
+ * glyphs of an embedded 5x7 bitmap font are put into an alpha texture atlas
+ * once. Whenever a readout changes, every label is laid out again into one
+ * vertex buffer of textured quads.
+ *
+ * The batched scene draws all glyphs with a single call, the per glyph scene
+ * draws the very same vertices with one call per glyph, so the difference
+ * between the two is the cost of the draw calls alone.
+ *
+ * The load is the number of labels and the characters per label.
+ */
+
+static bool initialize_batched();
+static bool initialize_per_glyph();
+static bool initialize();
+static void update(int64_t delta_ns);
+static void draw();
+static void deinitialize();
+static bool is_dirty();
+static int64_t get_next_change();
+static void set_load(size_t labels, size_t characters);
+static void get_load(size_t *labels, size_t *characters);
+
+struct Scene batched_text_scene = {
+    .name = "Label text batched",
+    .reports_damage = false,
+    .initialize = initialize_batched,
+    .update = update,
+    .draw = draw,
+    .deinitialize = deinitialize,
+    .is_dirty = is_dirty,
+    .get_next_change = get_next_change,
+    .set_load = set_load,
+    .get_load = get_load};
+
+struct Scene per_glyph_text_scene = {
+    .name = "Label text per glyph",
+    .reports_damage = false,
+    .initialize = initialize_per_glyph,
+    .update = update,
+    .draw = draw,
+    .deinitialize = deinitialize,
+    .is_dirty = is_dirty,
+    .get_next_change = get_next_change,
+    .set_load = set_load,
+    .get_load = get_load};
+
+// Glyphs are 5x7 pixels, each has a cell of 8x8 texels in the atlas
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+#define GLYPH_CELL 8
+#define ATLAS_COLUMNS 8
+#define ATLAS_SIZE (ATLAS_COLUMNS * GLYPH_CELL)
+// Pixels from one glyph to the next and from one label row to the next
+#define GLYPH_ADVANCE 6
+#define ROW_ADVANCE 10
+#define VERTICES_PER_GLYPH 6
+
+// Characters of the font, anything else is drawn as a space
+static const char font_characters[] = " %+-.0123456789:ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// One byte per column from left to right, the lowest bit is the top row
+static const uint8_t font_columns[][GLYPH_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x23, 0x13, 0x08, 0x64, 0x62}, // %
+    {0x08, 0x08, 0x3e, 0x08, 0x08}, // +
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // .
+    {0x3e, 0x51, 0x49, 0x45, 0x3e}, // 0
+    {0x00, 0x42, 0x7f, 0x40, 0x00}, // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // 2
+    {0x21, 0x41, 0x45, 0x4b, 0x31}, // 3
+    {0x18, 0x14, 0x12, 0x7f, 0x10}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+    {0x3c, 0x4a, 0x49, 0x49, 0x30}, // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1e}, // 9
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // :
+    {0x7e, 0x11, 0x11, 0x11, 0x7e}, // A
+    {0x7f, 0x49, 0x49, 0x49, 0x36}, // B
+    {0x3e, 0x41, 0x41, 0x41, 0x22}, // C
+    {0x7f, 0x41, 0x41, 0x22, 0x1c}, // D
+    {0x7f, 0x49, 0x49, 0x49, 0x41}, // E
+    {0x7f, 0x09, 0x09, 0x09, 0x01}, // F
+    {0x3e, 0x41, 0x49, 0x49, 0x7a}, // G
+    {0x7f, 0x08, 0x08, 0x08, 0x7f}, // H
+    {0x00, 0x41, 0x7f, 0x41, 0x00}, // I
+    {0x20, 0x40, 0x41, 0x3f, 0x01}, // J
+    {0x7f, 0x08, 0x14, 0x22, 0x41}, // K
+    {0x7f, 0x40, 0x40, 0x40, 0x40}, // L
+    {0x7f, 0x02, 0x0c, 0x02, 0x7f}, // M
+    {0x7f, 0x04, 0x08, 0x10, 0x7f}, // N
+    {0x3e, 0x41, 0x41, 0x41, 0x3e}, // O
+    {0x7f, 0x09, 0x09, 0x09, 0x06}, // P
+    {0x3e, 0x41, 0x51, 0x21, 0x5e}, // Q
+    {0x7f, 0x09, 0x19, 0x29, 0x46}, // R
+    {0x46, 0x49, 0x49, 0x49, 0x31}, // S
+    {0x01, 0x01, 0x7f, 0x01, 0x01}, // T
+    {0x3f, 0x40, 0x40, 0x40, 0x3f}, // U
+    {0x1f, 0x20, 0x40, 0x20, 0x1f}, // V
+    {0x3f, 0x40, 0x38, 0x40, 0x3f}, // W
+    {0x63, 0x14, 0x08, 0x14, 0x63}, // X
+    {0x07, 0x08, 0x70, 0x08, 0x07}, // Y
+    {0x61, 0x51, 0x49, 0x45, 0x43}, // Z
+};
+
+_Static_assert(sizeof(font_columns) / sizeof(font_columns[0]) == sizeof(font_characters) - 1,
+               "every character of the font needs its columns");
+_Static_assert(sizeof(font_columns) / sizeof(font_columns[0]) <= ATLAS_COLUMNS * ATLAS_COLUMNS,
+               "the glyphs have to fit into the atlas");
+
+struct GlyphVertex
+{
+    GLfloat position[2];
+    GLfloat texcoord[2];
+};
+
+// Parameters
+static size_t label_count = 400;
+static size_t character_count = 12;
+static int64_t sample_interval = 100l * MS_IN_NS;
+
+// Runtime values
+static bool batched;
+static int64_t sample_timer;
+// Time since the latest sample, readouts move towards it while animated
+static int64_t sample_age;
+// Readouts in [-100, 100] of the previous and the latest sample and as shown
+static float *previous_values;
+static float *latest_values;
+static float *shown_values;
+// Atlas cell per ASCII character
+static uint8_t glyph_cells[128];
+static struct GlyphVertex *vertices;
+static size_t glyph_count;
+static char *text;
+static size_t grid_columns;
+static size_t grid_rows;
+// Whether the readouts changed since the labels were laid out
+static bool layout_pending;
+// Whether update() changed what draw() shows since the last draw
+static bool dirty;
+
+static const float text_color[4] = {0.16, 0.62, 0.56, 1.0};
+
+static GLuint vbo;
+static GLuint atlas;
+
+#ifdef NIGHTMARE_USE_GLES2
+#define A_POSITION 0
+#define A_TEXCOORD 1
+
+static GLchar vertex_shader_source[] =
+    "attribute vec2 a_position;"
+    "attribute vec2 a_texcoord;"
+    "varying vec2 v_texcoord;"
+    "void main()"
+    "{"
+    "v_texcoord = a_texcoord;"
+    "gl_Position = vec4(a_position, 0.0, 1.0);"
+    "}";
+
+static GLchar fragment_shader_source[] =
+    "precision mediump float;"
+    "uniform sampler2D u_atlas;"
+    "uniform vec4 u_color;"
+    "varying vec2 v_texcoord;"
+    "void main()"
+    "{"
+    "gl_FragColor = vec4(u_color.rgb, u_color.a * texture2D(u_atlas, v_texcoord).a);"
+    "}";
+
+static GLuint shader_program;
+static GLint u_atlas;
+static GLint u_color;
+#endif
+
+static bool initialize_batched()
+{
+    batched = true;
+    return initialize();
+}
+
+static bool initialize_per_glyph()
+{
+    batched = false;
+    return initialize();
+}
+
+// Rasterizes the font into an alpha texture, power of two sized for GLES1
+static void create_atlas()
+{
+    uint8_t texels[ATLAS_SIZE * ATLAS_SIZE] = {0};
+
+    memset(glyph_cells, 0, sizeof(glyph_cells));
+    for (size_t glyph = 0; glyph < sizeof(font_characters) - 1; glyph++)
+    {
+        glyph_cells[(unsigned char)font_characters[glyph]] = glyph;
+
+        size_t cell_x = glyph % ATLAS_COLUMNS * GLYPH_CELL;
+        size_t cell_y = glyph / ATLAS_COLUMNS * GLYPH_CELL;
+        for (size_t column = 0; column < GLYPH_WIDTH; column++)
+        {
+            for (size_t row = 0; row < GLYPH_HEIGHT; row++)
+            {
+                if (font_columns[glyph][column] & (1 << row))
+                {
+                    texels[(cell_y + row) * ATLAS_SIZE + cell_x + column] = 0xff;
+                }
+            }
+        }
+    }
+
+    glGenTextures(1, &atlas);
+    register_gl_resource(GL_RESOURCE_TEXTURE, atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_SIZE, ATLAS_SIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, texels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static bool initialize()
+{
+    // Reset state
+    sample_timer = 0;
+    sample_age = 0;
+    glyph_count = 0;
+    layout_pending = true;
+    dirty = true;
+    reset_data_source();
+
+    // Labels are laid out in a grid with about the aspect ratio of the render target
+    double label_width = character_count * GLYPH_ADVANCE;
+    grid_columns = ceil(sqrt(label_count * (double)render_width * ROW_ADVANCE / (render_height * label_width)));
+    grid_columns = grid_columns > 0 ? grid_columns : 1;
+    grid_rows = (label_count + grid_columns - 1) / grid_columns;
+
+    previous_values = calloc(label_count, sizeof(float));
+    latest_values = calloc(label_count, sizeof(float));
+    shown_values = calloc(label_count, sizeof(float));
+    vertices = malloc(label_count * character_count * VERTICES_PER_GLYPH * sizeof(struct GlyphVertex));
+    text = malloc(character_count + 1);
+    if (!previous_values || !latest_values || !shown_values || !vertices || !text)
+    {
+        print_error("Failed to allocate memory for text scene\n");
+        return false;
+    }
+
+    create_atlas();
+
+    glGenBuffers(1, &vbo);
+    register_gl_resource(GL_RESOURCE_BUFFER, vbo);
+
+    // Setup graphics
+#ifdef NIGHTMARE_USE_GLES1
+    enable_gl_state(GL_STATE_CLIENT_STATE, GL_VERTEX_ARRAY);
+    enable_gl_state(GL_STATE_CLIENT_STATE, GL_TEXTURE_COORD_ARRAY);
+    enable_gl_state(GL_STATE_CAPABILITY, GL_TEXTURE_2D);
+
+    // The default GL_MODULATE takes the alpha of the atlas and the color of the text
+    glColor4x(to_fixed16(text_color[0]), to_fixed16(text_color[1]), to_fixed16(text_color[2]), 1 << 16);
+    glClearColorx(to_fixed16(0.91f), to_fixed16(0.77f), to_fixed16(0.42f), 1 << 16);
+#elif defined NIGHTMARE_USE_GLES2
+    const struct AttributeBinding bindings[] = {{A_POSITION, "a_position"}, {A_TEXCOORD, "a_texcoord"}};
+    bool success = build_program(&shader_program, vertex_shader_source, fragment_shader_source, bindings, 2);
+    if (!success)
+    {
+        print_error("Failed to build GL program for text scene\n");
+        return false;
+    }
+
+    glUseProgram(shader_program);
+
+    u_atlas = glGetUniformLocation(shader_program, "u_atlas");
+    u_color = glGetUniformLocation(shader_program, "u_color");
+    glUniform1i(u_atlas, 0);
+    glUniform4fv(u_color, 1, text_color);
+
+    enable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, A_POSITION);
+    enable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, A_TEXCOORD);
+
+    glClearColor(0.91f, 0.77f, 0.42f, 1.0f);
+#endif
+
+    glViewport(0, 0, render_width, render_height);
+
+    return true;
+}
+
+static void update(int64_t delta_ns)
+{
+    sample_timer -= delta_ns;
+
+    // Only the latest sample is shown, older ones which arrived in a burst are passed over
+    size_t steps = get_data_steps(&sample_timer, sample_interval, 1);
+    for (size_t step = 0; step < steps; step++)
+    {
+        for (size_t label = 0; label < label_count; label++)
+        {
+            previous_values[label] = shown_values[label];
+            latest_values[label] = get_data_sample(label) * 200.0f - 100.0f;
+        }
+        advance_data_source();
+
+        sample_age = 0;
+        layout_pending = true;
+        dirty = true;
+    }
+
+    // Animated readouts count towards the latest sample until the next one is due
+    bool animating = options.animation && sample_age < sample_interval;
+    if (options.animation)
+    {
+        sample_age += delta_ns;
+    }
+
+    if (steps > 0 || animating)
+    {
+        float progress = options.animation && sample_age < sample_interval ? (float)sample_age / sample_interval : 1.0f;
+        for (size_t label = 0; label < label_count; label++)
+        {
+            shown_values[label] = previous_values[label] + (latest_values[label] - previous_values[label]) * progress;
+        }
+
+        layout_pending = true;
+        dirty = true;
+    }
+}
+
+static void add_glyph(unsigned char character, float left, float top, float width, float height)
+{
+    size_t cell = glyph_cells[character < 128 ? character : ' '];
+    float u0 = (float)(cell % ATLAS_COLUMNS * GLYPH_CELL) / ATLAS_SIZE;
+    float v0 = (float)(cell / ATLAS_COLUMNS * GLYPH_CELL) / ATLAS_SIZE;
+    float u1 = u0 + (float)GLYPH_ADVANCE / ATLAS_SIZE;
+    float v1 = v0 + (float)GLYPH_CELL / ATLAS_SIZE;
+    float right = left + width;
+    float bottom = top - height;
+
+    // Two triangles, so glyphs need neither indices nor restarts between them
+    struct GlyphVertex *vertex = &vertices[glyph_count * VERTICES_PER_GLYPH];
+    vertex[0] = (struct GlyphVertex){{left, top}, {u0, v0}};
+    vertex[1] = (struct GlyphVertex){{left, bottom}, {u0, v1}};
+    vertex[2] = (struct GlyphVertex){{right, top}, {u1, v0}};
+    vertex[3] = vertex[2];
+    vertex[4] = vertex[1];
+    vertex[5] = (struct GlyphVertex){{right, bottom}, {u1, v1}};
+
+    glyph_count++;
+}
+
+// Formats every label and builds a quad per visible glyph
+static void layout_labels()
+{
+    float label_width = 2.0f / grid_columns;
+    float label_height = 2.0f / grid_rows;
+    float glyph_width = label_width / character_count;
+    float glyph_height = label_height * GLYPH_CELL / ROW_ADVANCE;
+    int value_width = character_count > 6 ? (int)character_count - 6 : 0;
+
+    glyph_count = 0;
+    for (size_t label = 0; label < label_count; label++)
+    {
+        float left = -1.0f + label % grid_columns * label_width;
+        float top = 1.0f - label / grid_columns * label_height;
+
+        snprintf(text, character_count + 1, "CH%03zu %+*.2f", label % 1000, value_width, shown_values[label]);
+
+        for (size_t c = 0; text[c] != '\0'; c++)
+        {
+            if (text[c] != ' ')
+            {
+                add_glyph(text[c], left + c * glyph_width, top, glyph_width, glyph_height);
+            }
+        }
+    }
+}
+
+static void draw()
+{
+    dirty = false;
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    if (layout_pending)
+    {
+        struct TraceSpan layout_span = trace_begin("layout");
+        layout_labels();
+        trace_end(&layout_span);
+
+        struct TraceSpan upload_span = trace_begin("upload");
+        size_t size = glyph_count * VERTICES_PER_GLYPH * sizeof(struct GlyphVertex);
+        glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
+        add_uploaded_bytes(size);
+        trace_end(&upload_span);
+
+        layout_pending = false;
+    }
+
+    // The upscale pass of render scaling rebinds the texture unit and the attribute arrays
+    glBindTexture(GL_TEXTURE_2D, atlas);
+#ifdef NIGHTMARE_USE_GLES1
+    glVertexPointer(2, GL_FLOAT, sizeof(struct GlyphVertex), (void *)offsetof(struct GlyphVertex, position));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(struct GlyphVertex), (void *)offsetof(struct GlyphVertex, texcoord));
+#elif defined NIGHTMARE_USE_GLES2
+    glVertexAttribPointer(A_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(struct GlyphVertex),
+                          (void *)offsetof(struct GlyphVertex, position));
+    glVertexAttribPointer(A_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(struct GlyphVertex),
+                          (void *)offsetof(struct GlyphVertex, texcoord));
+#endif
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if (batched)
+    {
+        glDrawArrays(GL_TRIANGLES, 0, glyph_count * VERTICES_PER_GLYPH);
+        add_draw_calls(1);
+    }
+    else
+    {
+        for (size_t glyph = 0; glyph < glyph_count; glyph++)
+        {
+            glDrawArrays(GL_TRIANGLES, glyph * VERTICES_PER_GLYPH, VERTICES_PER_GLYPH);
+        }
+        add_draw_calls(glyph_count);
+    }
+
+    glDisable(GL_BLEND);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void deinitialize()
+{
+    free(previous_values);
+    free(latest_values);
+    free(shown_values);
+    free(vertices);
+    free(text);
+    previous_values = NULL;
+    latest_values = NULL;
+    shown_values = NULL;
+    vertices = NULL;
+    text = NULL;
+
+#ifdef NIGHTMARE_USE_GLES1
+    disable_gl_state(GL_STATE_CAPABILITY, GL_TEXTURE_2D);
+    disable_gl_state(GL_STATE_CLIENT_STATE, GL_TEXTURE_COORD_ARRAY);
+    disable_gl_state(GL_STATE_CLIENT_STATE, GL_VERTEX_ARRAY);
+#elif defined NIGHTMARE_USE_GLES2
+    disable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, A_TEXCOORD);
+    disable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, A_POSITION);
+    glUseProgram(0);
+    delete_gl_resource(GL_RESOURCE_PROGRAM, shader_program);
+    shader_program = 0;
+#endif
+
+    delete_gl_resource(GL_RESOURCE_BUFFER, vbo);
+    delete_gl_resource(GL_RESOURCE_TEXTURE, atlas);
+    vbo = 0;
+    atlas = 0;
+}
+
+static bool is_dirty()
+{
+    return dirty;
+}
+
+static int64_t get_next_change()
+{
+    // Animated readouts change every frame until they reached the latest sample
+    if (options.animation && sample_age < sample_interval)
+    {
+        return 0;
+    }
+
+    return get_data_next_change(sample_timer);
+}
+
+static void set_load(size_t labels, size_t characters)
+{
+    label_count = labels;
+    character_count = characters;
+}
+
+static void get_load(size_t *labels, size_t *characters)
+{
+    (*labels) = label_count;
+    (*characters) = character_count;
+}
@@ -0,0 +1,7 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+extern struct Scene batched_text_scene;
+extern struct Scene per_glyph_text_scene;
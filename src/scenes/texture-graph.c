@@ -0,0 +1,335 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "texture-graph.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "common.h"
+#include "egl.h"
+#include "data-source.h"
+#include "scenes.h"
+#include "options.h"
+#include "trace.h"
+#include "gl-resources.h"
+
+/*
+ * Texture graph
+ *
+ * The samples of all lines stay resident in a texture, one row per line and
+ * one column per point. New samples only overwrite the oldest column and the
+ * vertex shader reads the samples starting at a ring offset, so scrolling
+ * moves no data at all. The x positions are a static vertex buffer.
+ *
+ * Lines which do not fit into the height of the texture are wrapped into
+ * further bands of columns to the right.
+ */
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+
+static bool is_supported();
+static bool initialize();
+static void update(int64_t delta_ns);
+static void draw();
+static void deinitialize();
+static bool is_dirty();
+static int64_t get_next_change();
+static void set_load(size_t lines, size_t points);
+static void get_load(size_t *lines, size_t *points);
+
+struct Scene texture_graph_scene = {
+    .name = "Texture graph",
+    .reports_damage = false,
+    .is_supported = is_supported,
+    .initialize = initialize,
+    .update = update,
+    .draw = draw,
+    .deinitialize = deinitialize,
+    .is_dirty = is_dirty,
+    .get_next_change = get_next_change,
+    .set_load = set_load,
+    .get_load = get_load};
+
+// Parameters
+static size_t line_count = 20;
+static size_t point_count = 15;
+static int64_t point_add_interval = 100l * MS_IN_NS;
+
+// Runtime values
+static int64_t point_add_timer;
+static size_t current_count;
+// Column of the oldest sample
+static size_t oldest_column;
+// Columns written by the next draw, consecutive from the first one
+static size_t pending_first;
+static size_t pending_count;
+static size_t rows;
+static size_t bands;
+// Samples of every column as RGBA texels, the sample is stored in the red
+// (high byte) and green channel. Consecutive lines are consecutive rows of a band.
+static uint8_t *column_data;
+// Whether update() changed what draw() shows since the last draw
+static bool dirty;
+
+static GLchar vertex_shader_source[] =
+    "attribute float a_point;"
+    "uniform sampler2D u_samples;"
+    "uniform float u_line;"
+    "uniform float u_offset;"
+    "uniform vec2 u_layout;"
+    "uniform vec2 u_texture_size;"
+    "uniform float u_x_step;"
+    "void main()"
+    "{"
+    "float band = floor(u_line / u_layout.y);"
+    "float row = u_line - band * u_layout.y;"
+    "float column = mod(a_point + u_offset, u_layout.x) + band * u_layout.x;"
+    "vec4 texel = texture2D(u_samples, (vec2(column, row) + 0.5) / u_texture_size);"
+    "float y = (texel.r * 65280.0 + texel.g * 255.0) / 65535.0 * 2.0 - 1.0;"
+    "gl_Position = vec4(a_point * u_x_step - 1.0, y, 0.0, 1.0);"
+    "}";
+
+static GLchar fragment_shader_source[] =
+    "void main()"
+    "{"
+    "gl_FragColor = vec4(0.16, 0.62, 0.56, 1.0);"
+    "}";
+
+static GLuint shader_program;
+static GLuint a_point = 0;
+static GLint u_samples;
+static GLint u_line;
+static GLint u_offset;
+static GLint u_layout;
+static GLint u_texture_size;
+static GLint u_x_step;
+static GLuint vbo;
+static GLuint texture;
+
+// Sampling textures in the vertex shader is optional in GLES2
+static bool is_supported()
+{
+    GLint vertex_texture_units = 0;
+    glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertex_texture_units);
+
+    return vertex_texture_units > 0;
+}
+
+static bool initialize()
+{
+    // Reset state
+    point_add_timer = 0;
+    current_count = 0;
+    oldest_column = 0;
+    pending_first = 0;
+    pending_count = 0;
+    dirty = true;
+    reset_data_source();
+
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+    rows = line_count < (size_t)max_texture_size ? line_count : (size_t)max_texture_size;
+    bands = (line_count + rows - 1) / rows;
+    if (point_count * bands > (size_t)max_texture_size)
+    {
+        print_error("%zu lines x %zu points do not fit into a texture of at most %ix%i\n",
+                    line_count, point_count, max_texture_size, max_texture_size);
+        return false;
+    }
+
+    column_data = calloc(line_count * point_count, 4);
+    if (!column_data)
+    {
+        print_error("Failed to allocate memory for texture graph column\n");
+        return false;
+    }
+
+    const struct AttributeBinding bindings[] = {{a_point, "a_point"}};
+    bool success = build_program(&shader_program, vertex_shader_source, fragment_shader_source, bindings, 1);
+    if (!success)
+    {
+        print_error("Failed to build GL program for texture graph scene\n");
+        return false;
+    }
+
+    glUseProgram(shader_program);
+
+    u_samples = glGetUniformLocation(shader_program, "u_samples");
+    u_line = glGetUniformLocation(shader_program, "u_line");
+    u_offset = glGetUniformLocation(shader_program, "u_offset");
+    u_layout = glGetUniformLocation(shader_program, "u_layout");
+    u_texture_size = glGetUniformLocation(shader_program, "u_texture_size");
+    u_x_step = glGetUniformLocation(shader_program, "u_x_step");
+
+    glUniform1i(u_samples, 0);
+    glUniform2f(u_layout, point_count, rows);
+    glUniform2f(u_texture_size, point_count * bands, rows);
+    glUniform1f(u_x_step, 2.0f / (float)(point_count - 1));
+
+    // The point index is the only vertex data and never changes
+    GLfloat *points = malloc(point_count * sizeof(GLfloat));
+    if (!points)
+    {
+        print_error("Failed to allocate memory for texture graph points\n");
+        return false;
+    }
+
+    for (size_t pi = 0; pi < point_count; pi++)
+    {
+        points[pi] = pi;
+    }
+
+    glGenBuffers(1, &vbo);
+    register_gl_resource(GL_RESOURCE_BUFFER, vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, point_count * sizeof(GLfloat), points, GL_STATIC_DRAW);
+    free(points);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    enable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, a_point);
+
+    // Nearest sampling without mipmaps keeps non power of two sizes complete
+    glGenTextures(1, &texture);
+    register_gl_resource(GL_RESOURCE_TEXTURE, texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, point_count * bands, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glClearColor(0.91f, 0.77f, 0.42f, 1.0f);
+    glViewport(0, 0, render_width, render_height);
+    glLineWidth(options.line_width);
+
+    return true;
+}
+
+static void update(int64_t delta_ns)
+{
+    point_add_timer -= delta_ns;
+
+    // Samples which arrived in a burst are all added within this frame
+    size_t steps = get_data_steps(&point_add_timer, point_add_interval, point_count);
+    for (size_t step = 0; step < steps; step++)
+    {
+        dirty = true;
+
+        // Overwrite the oldest column once every column holds a sample
+        size_t column;
+        if (current_count < point_count)
+        {
+            column = current_count;
+            current_count++;
+        }
+        else
+        {
+            column = oldest_column;
+            oldest_column = (oldest_column + 1) % point_count;
+        }
+
+        if (pending_count == 0)
+        {
+            pending_first = column;
+        }
+        if (pending_count < point_count)
+        {
+            pending_count++;
+        }
+
+        // Add the next sample of every line
+        for (size_t li = 0; li < line_count; li++)
+        {
+            uint8_t *texel = column_data + (column * line_count + li) * 4;
+            uint16_t value = get_data_sample(li) * 65535.0f;
+            texel[0] = value >> 8;
+            texel[1] = value & 0xff;
+        }
+        advance_data_source();
+    }
+}
+
+static void draw()
+{
+    dirty = false;
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // The upscale pass of render scaling rebinds the texture unit and the attribute array
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(a_point, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+
+    // Only the new columns are uploaded, once per band
+    if (pending_count > 0)
+    {
+        struct TraceSpan upload_span = trace_begin("upload");
+        for (size_t pending = 0; pending < pending_count; pending++)
+        {
+            size_t column = (pending_first + pending) % point_count;
+            for (size_t band = 0; band < bands; band++)
+            {
+                size_t first_line = band * rows;
+                size_t band_rows = line_count - first_line < rows ? line_count - first_line : rows;
+                glTexSubImage2D(GL_TEXTURE_2D, 0, band * point_count + column, 0, 1, band_rows,
+                                GL_RGBA, GL_UNSIGNED_BYTE, column_data + (column * line_count + first_line) * 4);
+            }
+        }
+        add_uploaded_bytes(pending_count * line_count * 4);
+        trace_end(&upload_span);
+        pending_count = 0;
+    }
+
+    glUniform1f(u_offset, oldest_column);
+
+    for (size_t li = 0; li < line_count; li++)
+    {
+        glUniform1f(u_line, li);
+        glDrawArrays(GL_LINE_STRIP, 0, current_count);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void deinitialize()
+{
+    free(column_data);
+    column_data = NULL;
+
+    disable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, a_point);
+    delete_gl_resource(GL_RESOURCE_BUFFER, vbo);
+    delete_gl_resource(GL_RESOURCE_TEXTURE, texture);
+    glUseProgram(0);
+    delete_gl_resource(GL_RESOURCE_PROGRAM, shader_program);
+    vbo = 0;
+    texture = 0;
+    shader_program = 0;
+}
+
+static bool is_dirty()
+{
+    return dirty;
+}
+
+static int64_t get_next_change()
+{
+    return get_data_next_change(point_add_timer);
+}
+
+static void set_load(size_t lines, size_t points)
+{
+    line_count = lines;
+    point_count = points;
+}
+
+static void get_load(size_t *lines, size_t *points)
+{
+    (*lines) = line_count;
+    (*points) = point_count;
+}
+#endif
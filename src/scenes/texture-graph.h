@@ -0,0 +1,8 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#ifdef NIGHTMARE_USE_GLES2
+extern struct Scene texture_graph_scene;
+#endif
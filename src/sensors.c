@@ -0,0 +1,555 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "sensors.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "results.h"
+
+/*
+ * Sensors
+ *
+ * A thread samples CPU frequencies, thermal zones and devfreq devices (GPUs)
+ * from sysfs at a fixed rate while scenes run. The samples are aligned with
+ * the frame timeline afterwards to flag frames rendered while throttled.
+ * The sysfs root is configurable to test against a fake directory tree.
+ */
+
+enum SensorType
+{
+    SENSOR_CPU_FREQUENCY,
+    SENSOR_TEMPERATURE,
+    SENSOR_DEVFREQ,
+};
+
+struct Sensor
+{
+    enum SensorType type;
+    char name[64];
+    int value_fd;
+    // Current frequency limit (scaling_max_freq or max_freq), -1 for thermal zones
+    int limit_fd;
+    // Highest frequency or the temperature of the first passive trip point (0 if unknown)
+    int64_t maximum;
+};
+
+static struct Sensor sensors[MAX_SENSORS];
+static size_t sensor_count = 0;
+static bool enabled = false;
+
+static pthread_t thread;
+static atomic_bool running = false;
+static int64_t interval_ns = 0;
+
+// Guards the recording
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool recording = false;
+static struct SensorSamples recorded = {NULL, 0, 0};
+
+static int64_t get_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * SEC_IN_NS + now.tv_nsec;
+}
+
+// sysfs attributes have to be read from the start on every sample
+static bool read_fd_value(int fd, int64_t *value)
+{
+    char text[32];
+    ssize_t length = pread(fd, text, sizeof(text) - 1, 0);
+    if (length <= 0)
+    {
+        return false;
+    }
+
+    text[length] = '\0';
+    (*value) = strtoll(text, NULL, 10);
+
+    return true;
+}
+
+static bool read_path_value(const char *path, int64_t *value)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool success = read_fd_value(fd, value);
+    close(fd);
+
+    return success;
+}
+
+static bool read_path_text(const char *path, char *text, size_t size)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool success = fgets(text, (int)size, file) != NULL;
+    fclose(file);
+
+    if (success)
+    {
+        text[strcspn(text, "\n")] = '\0';
+    }
+
+    return success;
+}
+
+static struct Sensor *add_sensor(enum SensorType type, const char *value_path, const char *limit_path)
+{
+    if (sensor_count >= MAX_SENSORS)
+    {
+        return NULL;
+    }
+
+    int value_fd = open(value_path, O_RDONLY);
+    if (value_fd < 0)
+    {
+        return NULL;
+    }
+
+    struct Sensor *sensor = &sensors[sensor_count++];
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->type = type;
+    sensor->value_fd = value_fd;
+    sensor->limit_fd = limit_path ? open(limit_path, O_RDONLY) : -1;
+
+    return sensor;
+}
+
+// Orders cpu2 before cpu10
+static int compare_names(const struct dirent **a, const struct dirent **b)
+{
+    size_t length_a = strlen((*a)->d_name);
+    size_t length_b = strlen((*b)->d_name);
+    if (length_a != length_b)
+    {
+        return length_a < length_b ? -1 : 1;
+    }
+
+    return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+static bool join_path(char *path, const char *directory, const char *entry, const char *attribute)
+{
+    return snprintf(path, PATH_MAX, "%s/%s/%s", directory, entry, attribute) < PATH_MAX;
+}
+
+static void discover_cpus(const char *root)
+{
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), "%s/devices/system/cpu", root);
+
+    struct dirent **entries;
+    int count = scandir(directory, &entries, NULL, compare_names);
+    for (int i = 0; i < count; i++)
+    {
+        int cpu;
+        char trailing;
+        if (sscanf(entries[i]->d_name, "cpu%d%c", &cpu, &trailing) == 1)
+        {
+            const char *name = entries[i]->d_name;
+            char value_path[PATH_MAX], limit_path[PATH_MAX], maximum_path[PATH_MAX];
+            bool joined = join_path(value_path, directory, name, "cpufreq/scaling_cur_freq") &&
+                          join_path(limit_path, directory, name, "cpufreq/scaling_max_freq") &&
+                          join_path(maximum_path, directory, name, "cpufreq/cpuinfo_max_freq");
+
+            struct Sensor *sensor = joined ? add_sensor(SENSOR_CPU_FREQUENCY, value_path, limit_path) : NULL;
+            if (sensor)
+            {
+                snprintf(sensor->name, sizeof(sensor->name), "cpu%d_khz", cpu);
+                read_path_value(maximum_path, &sensor->maximum);
+            }
+        }
+        free(entries[i]);
+    }
+
+    if (count >= 0)
+    {
+        free(entries);
+    }
+}
+
+static void discover_thermal_zones(const char *root)
+{
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), "%s/class/thermal", root);
+
+    struct dirent **entries;
+    int count = scandir(directory, &entries, NULL, compare_names);
+    for (int i = 0; i < count; i++)
+    {
+        int zone;
+        char trailing;
+        if (sscanf(entries[i]->d_name, "thermal_zone%d%c", &zone, &trailing) == 1)
+        {
+            const char *name = entries[i]->d_name;
+            char value_path[PATH_MAX];
+            bool joined = join_path(value_path, directory, name, "temp");
+
+            struct Sensor *sensor = joined ? add_sensor(SENSOR_TEMPERATURE, value_path, NULL) : NULL;
+            if (sensor)
+            {
+                snprintf(sensor->name, sizeof(sensor->name), "thermal_zone%d_mc", zone);
+
+                // Passive trip points are where the kernel starts to throttle
+                for (int trip = 0;; trip++)
+                {
+                    char type_attribute[32], temperature_attribute[32];
+                    snprintf(type_attribute, sizeof(type_attribute), "trip_point_%d_type", trip);
+                    snprintf(temperature_attribute, sizeof(temperature_attribute), "trip_point_%d_temp", trip);
+
+                    char type_path[PATH_MAX], temperature_path[PATH_MAX], type[32];
+                    if (!join_path(type_path, directory, name, type_attribute) ||
+                        !join_path(temperature_path, directory, name, temperature_attribute) ||
+                        !read_path_text(type_path, type, sizeof(type)))
+                    {
+                        break;
+                    }
+
+                    if (strcmp(type, "passive") == 0 && read_path_value(temperature_path, &sensor->maximum))
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        free(entries[i]);
+    }
+
+    if (count >= 0)
+    {
+        free(entries);
+    }
+}
+
+static void discover_devfreq(const char *root)
+{
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), "%s/class/devfreq", root);
+
+    struct dirent **entries;
+    int count = scandir(directory, &entries, NULL, compare_names);
+    for (int i = 0; i < count; i++)
+    {
+        const char *device = entries[i]->d_name;
+        if (device[0] != '.')
+        {
+            char value_path[PATH_MAX], limit_path[PATH_MAX], frequencies_path[PATH_MAX];
+            bool joined = join_path(value_path, directory, device, "cur_freq") &&
+                          join_path(limit_path, directory, device, "max_freq") &&
+                          join_path(frequencies_path, directory, device, "available_frequencies");
+
+            struct Sensor *sensor = joined ? add_sensor(SENSOR_DEVFREQ, value_path, limit_path) : NULL;
+            if (sensor)
+            {
+                snprintf(sensor->name, sizeof(sensor->name), "%.56s_hz", device);
+
+                // The highest available frequency, or the limit at startup if the list is missing
+                char frequencies[1024];
+                if (read_path_text(frequencies_path, frequencies, sizeof(frequencies)))
+                {
+                    char *end = frequencies;
+                    while (*end)
+                    {
+                        char *start = end;
+                        int64_t frequency = strtoll(start, &end, 10);
+                        if (end == start)
+                        {
+                            break;
+                        }
+                        if (frequency > sensor->maximum)
+                        {
+                            sensor->maximum = frequency;
+                        }
+                    }
+                }
+                else
+                {
+                    read_path_value(limit_path, &sensor->maximum);
+                }
+            }
+        }
+        free(entries[i]);
+    }
+
+    if (count >= 0)
+    {
+        free(entries);
+    }
+}
+
+static void take_sample(struct SensorSample *sample)
+{
+    sample->time_ns = get_now_ns();
+    sample->throttled = false;
+
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        struct Sensor *sensor = &sensors[i];
+        int64_t value = -1;
+        read_fd_value(sensor->value_fd, &value);
+        sample->values[i] = value;
+
+        if (sensor->maximum <= 0)
+        {
+            continue;
+        }
+
+        if (sensor->type == SENSOR_TEMPERATURE)
+        {
+            sample->throttled |= value >= sensor->maximum;
+        }
+        else
+        {
+            int64_t limit;
+            if (sensor->limit_fd >= 0 && read_fd_value(sensor->limit_fd, &limit))
+            {
+                sample->throttled |= limit < sensor->maximum;
+            }
+        }
+    }
+}
+
+static bool sensor_samples_append(struct SensorSamples *samples, const struct SensorSample *sample)
+{
+    if (samples->count == samples->capacity)
+    {
+        size_t capacity = samples->capacity ? samples->capacity * 2 : 256;
+        struct SensorSample *resized = realloc(samples->samples, capacity * sizeof(struct SensorSample));
+        if (!resized)
+        {
+            return false;
+        }
+
+        samples->samples = resized;
+        samples->capacity = capacity;
+    }
+
+    samples->samples[samples->count++] = (*sample);
+
+    return true;
+}
+
+static void *sample_sensors(void *argument)
+{
+    (void)argument;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load(&running))
+    {
+        struct SensorSample sample;
+        take_sample(&sample);
+
+        pthread_mutex_lock(&mutex);
+        if (recording)
+        {
+            sensor_samples_append(&recorded, &sample);
+        }
+        pthread_mutex_unlock(&mutex);
+
+        // Absolute deadlines keep the rate fixed regardless of the time spent sampling
+        int64_t next_ns = (int64_t)next.tv_sec * SEC_IN_NS + next.tv_nsec + interval_ns;
+        next.tv_sec = next_ns / SEC_IN_NS;
+        next.tv_nsec = next_ns % SEC_IN_NS;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+bool initialize_sensors(const char *sysfs_root, int interval_ms)
+{
+    sensor_count = 0;
+    discover_cpus(sysfs_root);
+    discover_thermal_zones(sysfs_root);
+    discover_devfreq(sysfs_root);
+
+    if (sensor_count == 0)
+    {
+        print_error("No CPU frequency, thermal zone or devfreq sensors found in '%s'\n", sysfs_root);
+        return false;
+    }
+
+    interval_ns = (int64_t)interval_ms * MS_IN_NS;
+    atomic_store(&running, true);
+    if (pthread_create(&thread, NULL, sample_sensors, NULL) != 0)
+    {
+        print_error("Could not start the sensor sampling thread\n");
+        atomic_store(&running, false);
+        cleanup_sensors();
+        return false;
+    }
+
+    enabled = true;
+    print("Sampling %zu sensors every %i ms\n\n", sensor_count, interval_ms);
+
+    return true;
+}
+
+void cleanup_sensors()
+{
+    if (enabled)
+    {
+        atomic_store(&running, false);
+        pthread_join(thread, NULL);
+        enabled = false;
+    }
+
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        close(sensors[i].value_fd);
+        if (sensors[i].limit_fd >= 0)
+        {
+            close(sensors[i].limit_fd);
+        }
+    }
+    sensor_count = 0;
+
+    sensor_samples_free(&recorded);
+}
+
+bool are_sensors_enabled()
+{
+    return enabled;
+}
+
+size_t get_sensor_count()
+{
+    return sensor_count;
+}
+
+const char *get_sensor_name(size_t index)
+{
+    return sensors[index].name;
+}
+
+// The recording is bounded by samples taken right away, so even runs shorter
+// than the interval have a reading before and after them
+void sensors_begin_recording()
+{
+    struct SensorSample sample;
+    take_sample(&sample);
+
+    pthread_mutex_lock(&mutex);
+    recorded.count = 0;
+    sensor_samples_append(&recorded, &sample);
+    recording = true;
+    pthread_mutex_unlock(&mutex);
+}
+
+// Hands the samples recorded since sensors_begin_recording() over to the caller
+void sensors_end_recording(struct SensorSamples *samples)
+{
+    struct SensorSample sample;
+    take_sample(&sample);
+
+    pthread_mutex_lock(&mutex);
+    sensor_samples_append(&recorded, &sample);
+    recording = false;
+    (*samples) = recorded;
+    recorded.samples = NULL;
+    recorded.count = 0;
+    recorded.capacity = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+void sensor_samples_free(struct SensorSamples *samples)
+{
+    free(samples->samples);
+    samples->samples = NULL;
+    samples->count = 0;
+    samples->capacity = 0;
+}
+
+void get_sensor_summary(const struct SensorSamples *samples, struct SensorSummary *summary)
+{
+    summary->max_temperature_mc = -1;
+    summary->min_cpu_khz = -1;
+    summary->min_devfreq_hz = -1;
+
+    for (size_t s = 0; s < sensor_count; s++)
+    {
+        for (size_t i = 0; i < samples->count; i++)
+        {
+            int64_t value = samples->samples[i].values[s];
+            if (value < 0)
+            {
+                continue;
+            }
+
+            switch (sensors[s].type)
+            {
+            case SENSOR_TEMPERATURE:
+                if (value > summary->max_temperature_mc)
+                {
+                    summary->max_temperature_mc = value;
+                }
+                break;
+            case SENSOR_CPU_FREQUENCY:
+                if (summary->min_cpu_khz < 0 || value < summary->min_cpu_khz)
+                {
+                    summary->min_cpu_khz = value;
+                }
+                break;
+            case SENSOR_DEVFREQ:
+                if (summary->min_devfreq_hz < 0 || value < summary->min_devfreq_hz)
+                {
+                    summary->min_devfreq_hz = value;
+                }
+                break;
+            }
+        }
+    }
+}
+
+// A frame counts as throttled if a sample taken while it was rendered, or
+// the last one before it ended, reports throttling. Returns the number of
+// throttled frames.
+size_t flag_throttled_frames(struct FrameSamples *frames, const struct SensorSamples *samples)
+{
+    size_t throttled = 0;
+    size_t next = 0;
+
+    for (size_t i = 0; i < frames->count; i++)
+    {
+        struct FrameSample *frame = &frames->samples[i];
+        int64_t frame_end_ns = frame->started_ns + frame->frame_ns;
+
+        // Last sample before the frame started
+        while (next < samples->count && samples->samples[next].time_ns <= frame->started_ns)
+        {
+            next++;
+        }
+
+        frame->throttled = next > 0 && samples->samples[next - 1].throttled;
+        for (size_t s = next; s < samples->count && samples->samples[s].time_ns <= frame_end_ns; s++)
+        {
+            frame->throttled |= samples->samples[s].throttled;
+        }
+
+        throttled += frame->throttled;
+    }
+
+    return throttled;
+}
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_SENSORS 64
+
+struct FrameSamples;
+
+struct SensorSample
+{
+    // CLOCK_MONOTONIC
+    int64_t time_ns;
+    // A frequency is capped below its maximum or a zone is past its passive trip point
+    bool throttled;
+    int64_t values[MAX_SENSORS];
+};
+
+struct SensorSamples
+{
+    struct SensorSample *samples;
+    size_t count;
+    size_t capacity;
+};
+
+// Extremes over all sensors of a kind, -1 if there is no such sensor
+struct SensorSummary
+{
+    int64_t max_temperature_mc;
+    int64_t min_cpu_khz;
+    int64_t min_devfreq_hz;
+};
+
+bool initialize_sensors(const char *sysfs_root, int interval_ms);
+void cleanup_sensors();
+bool are_sensors_enabled();
+
+size_t get_sensor_count();
+// Column name including the unit, e.g. cpu0_khz or thermal_zone0_mc
+const char *get_sensor_name(size_t index);
+
+void sensors_begin_recording();
+void sensors_end_recording(struct SensorSamples *samples);
+void sensor_samples_free(struct SensorSamples *samples);
+void get_sensor_summary(const struct SensorSamples *samples, struct SensorSummary *summary);
+
+size_t flag_throttled_frames(struct FrameSamples *frames, const struct SensorSamples *samples);
@@ -0,0 +1,299 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data-source.h"
+
+/*
+ * Series converter
+ *
+ * Writes the series files nightmare replays with --data. The input is text
+ * with one sample per line and the value of every channel separated by
+ * commas, lines which are empty or start with '#' are skipped. The values
+ * are stored as one array per channel behind the header, the value range is
+ * the one of the samples unless it is given.
+ */
+
+struct SeriesOptions
+{
+    const char *output_path;
+    // Milliseconds between two samples (0 keeps the interval of the scene)
+    double interval_ms;
+    bool has_minimum;
+    bool has_maximum;
+    float minimum;
+    float maximum;
+};
+
+static struct SeriesOptions series_options = {
+    .output_path = NULL,
+    .interval_ms = 0.0,
+    .has_minimum = false,
+    .has_maximum = false,
+};
+
+enum
+{
+    OPTION_MINIMUM = 256,
+    OPTION_MAXIMUM,
+};
+
+static const struct option long_options[] = {
+    {"help", no_argument, NULL, 'h'},
+    {"output", required_argument, NULL, 'o'},
+    {"interval", required_argument, NULL, 'i'},
+    {"minimum", required_argument, NULL, OPTION_MINIMUM},
+    {"maximum", required_argument, NULL, OPTION_MAXIMUM},
+    {NULL, 0, NULL, 0},
+};
+
+// Values of all samples as they were read, sample after sample
+static float *values = NULL;
+static size_t value_count = 0;
+static size_t value_capacity = 0;
+static uint32_t channel_count = 0;
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options] --output FILE [INPUT]\n", program_name);
+    printf("\n");
+    printf("Converts comma separated samples, one per line, from INPUT (default stdin) into a series file.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -h, --help            Show this help\n");
+    printf("  -o, --output FILE     Series file to write\n");
+    printf("  -i, --interval MS     Recorded time between two samples (default 0 keeps the interval of the scenes)\n");
+    printf("  --minimum V           Value drawn at the bottom of the graph (default smallest sample)\n");
+    printf("  --maximum V           Value drawn at the top of the graph (default largest sample)\n");
+}
+
+static bool parse_double(const char *text, double *value)
+{
+    char *end;
+    double result = strtod(text, &end);
+    if (end == text || *end != '\0')
+    {
+        return false;
+    }
+
+    (*value) = result;
+    return true;
+}
+
+static bool add_value(float value)
+{
+    if (value_count == value_capacity)
+    {
+        size_t capacity = value_capacity > 0 ? value_capacity * 2 : 4096;
+        float *grown = realloc(values, capacity * sizeof(float));
+        if (!grown)
+        {
+            fprintf(stderr, "Failed to allocate memory for the samples\n");
+            return false;
+        }
+        values = grown;
+        value_capacity = capacity;
+    }
+
+    values[value_count++] = value;
+    return true;
+}
+
+// Adds the values of one line, every line has to have as many as the first one
+static bool parse_line(char *line, size_t line_number)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#')
+    {
+        return true;
+    }
+
+    uint32_t count = 0;
+    for (char *field = strtok(line, ","); field; field = strtok(NULL, ","))
+    {
+        char *end;
+        float value = strtof(field, &end);
+        while (*end == ' ' || *end == '\t')
+        {
+            end++;
+        }
+        if (end == field || *end != '\0')
+        {
+            fprintf(stderr, "Invalid value '%s' on line %zu\n", field, line_number);
+            return false;
+        }
+
+        if (!add_value(value))
+        {
+            return false;
+        }
+        count++;
+    }
+
+    if (channel_count == 0)
+    {
+        channel_count = count;
+    }
+    else if (count != channel_count)
+    {
+        fprintf(stderr, "Line %zu has %u values instead of %u\n", line_number, count, channel_count);
+        return false;
+    }
+
+    return true;
+}
+
+static bool read_samples(FILE *input)
+{
+    char line[4096];
+    size_t line_number = 0;
+    while (fgets(line, sizeof(line), input))
+    {
+        line_number++;
+        if (strlen(line) == sizeof(line) - 1 && line[sizeof(line) - 2] != '\n')
+        {
+            fprintf(stderr, "Line %zu is too long\n", line_number);
+            return false;
+        }
+
+        if (!parse_line(line, line_number))
+        {
+            return false;
+        }
+    }
+
+    if (channel_count == 0)
+    {
+        fprintf(stderr, "The input has no samples\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool write_series(const char *path)
+{
+    size_t sample_count = value_count / channel_count;
+
+    struct SeriesHeader header = {0};
+    memcpy(header.magic, SERIES_MAGIC, sizeof(header.magic));
+    header.version = SERIES_VERSION;
+    header.channel_count = channel_count;
+    header.sample_count = sample_count;
+    header.data_offset = sizeof(header);
+    header.minimum = values[0];
+    header.maximum = values[0];
+    for (size_t i = 1; i < value_count; i++)
+    {
+        header.minimum = values[i] < header.minimum ? values[i] : header.minimum;
+        header.maximum = values[i] > header.maximum ? values[i] : header.maximum;
+    }
+    header.minimum = series_options.has_minimum ? series_options.minimum : header.minimum;
+    header.maximum = series_options.has_maximum ? series_options.maximum : header.maximum;
+    header.sample_interval_ns = series_options.interval_ms * 1e6;
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open '%s' for writing\n", path);
+        return false;
+    }
+
+    // Channels are stored one after another, the samples are read channel by channel
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t channel = 0; channel < channel_count && success; channel++)
+    {
+        for (size_t sample = 0; sample < sample_count && success; sample++)
+        {
+            success = fwrite(&values[sample * channel_count + channel], sizeof(float), 1, file) == 1;
+        }
+    }
+
+    success = fclose(file) == 0 && success;
+    if (!success)
+    {
+        fprintf(stderr, "Failed to write '%s'\n", path);
+        return false;
+    }
+
+    printf("Wrote %u channels x %zu samples to '%s'\n", channel_count, sample_count, path);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int option;
+    double value;
+    while ((option = getopt_long(argc, argv, "ho:i:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        case 'o':
+            series_options.output_path = optarg;
+            break;
+        case 'i':
+            if (!parse_double(optarg, &series_options.interval_ms) || series_options.interval_ms < 0.0)
+            {
+                fprintf(stderr, "Invalid interval '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case OPTION_MINIMUM:
+        case OPTION_MAXIMUM:
+            if (!parse_double(optarg, &value))
+            {
+                fprintf(stderr, "Invalid value '%s'\n", optarg);
+                return 1;
+            }
+            if (option == OPTION_MINIMUM)
+            {
+                series_options.has_minimum = true;
+                series_options.minimum = value;
+            }
+            else
+            {
+                series_options.has_maximum = true;
+                series_options.maximum = value;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!series_options.output_path || argc - optind > 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (optind < argc && strcmp(argv[optind], "-") != 0)
+    {
+        input = fopen(argv[optind], "r");
+        if (!input)
+        {
+            fprintf(stderr, "Could not open '%s'\n", argv[optind]);
+            return 1;
+        }
+    }
+
+    bool success = read_samples(input) && write_series(series_options.output_path);
+
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    free(values);
+
+    return success ? 0 : 1;
+}
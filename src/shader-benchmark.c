@@ -0,0 +1,334 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "shader-benchmark.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "backend.h"
+#include "common.h"
+#include "egl.h"
+#include "gl-resources.h"
+#include "options.h"
+#include "results.h"
+#include "signal-handler.h"
+#include "trace.h"
+
+/*
+ * Shader compilation benchmark
+ *
+ * Generates shader variants of increasing size and measures how long the
+ * driver takes to compile, link and draw with them for the first time. Many
+ * drivers defer the actual code generation to the first draw, which is why
+ * it is measured separately from the link.
+ */
+
+#ifdef NIGHTMARE_USE_GLES2
+#include <GLES2/gl2.h>
+
+// Fragment shader operations of the largest variant
+#define MAX_OPERATIONS 512
+#define REPETITIONS 3
+
+struct ShaderTimings
+{
+    int64_t compile_ns;
+    int64_t link_ns;
+    int64_t first_draw_ns;
+    int64_t second_draw_ns;
+};
+
+static const GLfloat triangle[] = {
+    -1.0, -1.0,
+    3.0, -1.0,
+    -1.0, 3.0,
+};
+
+// Makes every generated source unique, so neither the in-process nor the
+// on-disk shader cache of the driver can serve a variant. It is printed with
+// a fixed width, so the source size does not depend on its value.
+static unsigned salt = 0;
+
+static size_t append(char *buffer, size_t size, size_t length, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static size_t append(char *buffer, size_t size, size_t length, const char *format, ...)
+{
+    if (length >= size)
+    {
+        return length;
+    }
+
+    va_list arguments;
+    va_start(arguments, format);
+    int written = vsnprintf(buffer + length, size - length, format, arguments);
+    va_end(arguments);
+
+    return written > 0 ? length + written : length;
+}
+
+// Alternates transcendental functions, arithmetic and branches
+static char *generate_fragment_shader(int operations)
+{
+    size_t size = 256 + operations * 96;
+    char *source = malloc(size);
+    if (!source)
+    {
+        return NULL;
+    }
+
+    size_t length = 0;
+    length = append(source, size, length,
+                    "precision mediump float;"
+                    "varying vec2 v_position;"
+                    "void main()"
+                    "{"
+                    "float value = %08u.0 / 65536.0;",
+                    salt++);
+
+    for (int i = 0; i < operations; i++)
+    {
+        switch (i % 3)
+        {
+        case 0:
+            length = append(source, size, length, "value = sin(value * %i.5 + v_position.x);", i % 7 + 1);
+            break;
+        case 1:
+            length = append(source, size, length, "value = value * 0.5 + v_position.y * %i.25;", i % 5);
+            break;
+        case 2:
+            length = append(source, size, length,
+                            "if (value > 0.5) { value -= 0.%i; } else { value += v_position.x; }", i % 9 + 1);
+            break;
+        }
+    }
+
+    length = append(source, size, length, "gl_FragColor = vec4(value, v_position, 1.0);}");
+
+    if (length >= size)
+    {
+        free(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+// The vertex stage grows with a quarter of the fragment operations
+static char *generate_vertex_shader(int operations)
+{
+    int vertex_operations = operations / 4;
+    size_t size = 256 + vertex_operations * 64;
+    char *source = malloc(size);
+    if (!source)
+    {
+        return NULL;
+    }
+
+    size_t length = 0;
+    length = append(source, size, length,
+                    "attribute vec2 a_position;"
+                    "varying vec2 v_position;"
+                    "void main()"
+                    "{"
+                    "vec2 position = a_position * %08u.0 / 65536.0;",
+                    salt++);
+
+    for (int i = 0; i < vertex_operations; i++)
+    {
+        length = append(source, size, length, "position = position * 0.%i + a_position.yx;", i % 9 + 1);
+    }
+
+    length = append(source, size, length, "v_position = position;gl_Position = vec4(a_position, 0.0, 1.0);}");
+
+    if (length >= size)
+    {
+        free(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+static int64_t get_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * SEC_IN_NS + now.tv_nsec;
+}
+
+static void draw_triangle(GLuint program)
+{
+    glUseProgram(program);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glFinish();
+}
+
+static bool measure_variant(int operations, size_t *source_size, struct ShaderTimings *timings)
+{
+    char *vertex_source = generate_vertex_shader(operations);
+    char *fragment_source = generate_fragment_shader(operations);
+    bool success = false;
+
+    if (!vertex_source || !fragment_source)
+    {
+        print_error("Failed to generate shader sources\n");
+        goto finish;
+    }
+
+    (*source_size) = strlen(vertex_source) + strlen(fragment_source);
+
+    int64_t started = get_now_ns();
+    GLuint vertex_shader = load_shader(vertex_source, GL_VERTEX_SHADER);
+    if (!vertex_shader)
+    {
+        goto finish;
+    }
+
+    GLuint fragment_shader = load_shader(fragment_source, GL_FRAGMENT_SHADER);
+    if (!fragment_shader)
+    {
+        delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+        goto finish;
+    }
+    int64_t compiled = get_now_ns();
+
+    GLuint program = glCreateProgram();
+    if (!program)
+    {
+        print_error("Failed to create program\n");
+        delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+        delete_gl_resource(GL_RESOURCE_SHADER, fragment_shader);
+        goto finish;
+    }
+
+    register_gl_resource(GL_RESOURCE_PROGRAM, program);
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    delete_gl_resource(GL_RESOURCE_SHADER, vertex_shader);
+    delete_gl_resource(GL_RESOURCE_SHADER, fragment_shader);
+    glBindAttribLocation(program, 0, "a_position");
+
+    if (!link_program(program))
+    {
+        goto finish;
+    }
+    int64_t linked = get_now_ns();
+
+    struct TraceSpan span = trace_begin("first draw");
+    draw_triangle(program);
+    trace_end(&span);
+    int64_t first_drawn = get_now_ns();
+
+    draw_triangle(program);
+    int64_t second_drawn = get_now_ns();
+
+    glUseProgram(0);
+    delete_gl_resource(GL_RESOURCE_PROGRAM, program);
+
+    timings->compile_ns = compiled - started;
+    timings->link_ns = linked - compiled;
+    timings->first_draw_ns = first_drawn - linked;
+    timings->second_draw_ns = second_drawn - first_drawn;
+
+    success = true;
+
+finish:
+    free(vertex_source);
+    free(fragment_source);
+
+    return success;
+}
+
+static int compare_durations(const void *a, const void *b)
+{
+    int64_t duration_a = *(const int64_t *)a;
+    int64_t duration_b = *(const int64_t *)b;
+
+    return (duration_a > duration_b) - (duration_a < duration_b);
+}
+
+static double get_median_ms(int64_t *durations, size_t count)
+{
+    qsort(durations, count, sizeof(int64_t), compare_durations);
+
+    return (double)durations[count / 2] / MS_IN_NS;
+}
+
+bool run_shader_benchmark()
+{
+    print("Shader compilation\n");
+    print("------------------\n");
+    print("Median of %i repetitions, every variant is unique to bypass driver caches\n", REPETITIONS);
+    print("%10s %10s %12s %10s %14s %15s\n", "operations", "bytes", "compile ms", "link ms", "first draw ms", "second draw ms");
+
+    // Unique per run, as drivers may keep compiled shaders on disk
+    salt = (unsigned)(get_now_ns() & 0xffff) * 1024;
+
+    glViewport(0, 0, screen_width, screen_height);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, triangle);
+    enable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, 0);
+
+    bool success = true;
+    for (int operations = 1; operations <= MAX_OPERATIONS && !sigint_triggered; operations *= 2)
+    {
+        int64_t compile_ns[REPETITIONS], link_ns[REPETITIONS];
+        int64_t first_draw_ns[REPETITIONS], second_draw_ns[REPETITIONS];
+        size_t source_size = 0;
+
+        for (int i = 0; i < REPETITIONS; i++)
+        {
+            struct ShaderTimings timings;
+            if (!measure_variant(operations, &source_size, &timings))
+            {
+                print_error("Failed to measure shader variant with %i operations\n", operations);
+                success = false;
+                goto finish;
+            }
+
+            compile_ns[i] = timings.compile_ns;
+            link_ns[i] = timings.link_ns;
+            first_draw_ns[i] = timings.first_draw_ns;
+            second_draw_ns[i] = timings.second_draw_ns;
+        }
+
+        struct SceneResult result = {
+            .scene_name = "Shader compilation",
+            .backend = BACKEND_NAME,
+            .config = egl_config_info,
+            .render_scale = options.render_scale,
+            .antialiasing = options.antialiasing,
+        };
+        result_add_parameter(&result, "operations", operations);
+        result_add_metric(&result, "compile_ms", get_median_ms(compile_ns, REPETITIONS));
+        result_add_metric(&result, "link_ms", get_median_ms(link_ns, REPETITIONS));
+        result_add_metric(&result, "first_draw_ms", get_median_ms(first_draw_ns, REPETITIONS));
+        result_add_metric(&result, "second_draw_ms", get_median_ms(second_draw_ns, REPETITIONS));
+        result_add_metric(&result, "source_bytes", source_size);
+        results_add(&result);
+
+        print("%10i %10zu %12.3f %10.3f %14.3f %15.3f\n",
+              operations, source_size,
+              result.metrics[0].value, result.metrics[1].value, result.metrics[2].value, result.metrics[3].value);
+    }
+
+finish:
+    disable_gl_state(GL_STATE_VERTEX_ATTRIB_ARRAY, 0);
+    print("---\n");
+
+    return success;
+}
+#else
+bool run_shader_benchmark()
+{
+    print_error("The shader benchmark requires GLES2\n");
+
+    return false;
+}
+#endif
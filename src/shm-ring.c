@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "shm-ring.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Shared memory ring
+ *
+ * Single producer, single consumer ring buffer in a POSIX shared memory
+ * object. The producer writes a record and then publishes it by advancing
+ * head with release semantics, the consumer reads records up to head and
+ * returns their space by advancing tail. Neither side ever waits for the
+ * other. The indices are free running 32 bit counters, which stay lock-free
+ * on every architecture and wrap around consistently since the capacity is a
+ * power of two.
+ */
+
+_Static_assert(sizeof(struct ShmRingHeader) % 64 == 0, "records have to start on a cache line");
+
+static size_t get_record_size(uint32_t channel_count)
+{
+    size_t size = sizeof(struct ShmRingRecord) + channel_count * sizeof(float);
+    return (size + sizeof(int64_t) - 1) / sizeof(int64_t) * sizeof(int64_t);
+}
+
+static bool map_ring(struct ShmRing *ring, int fd, size_t size, int protection)
+{
+    void *mapping = mmap(NULL, size, protection, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    ring->header = mapping;
+    ring->records = (uint8_t *)mapping + sizeof(struct ShmRingHeader);
+    ring->size = size;
+
+    return true;
+}
+
+bool shm_ring_create(struct ShmRing *ring, const char *name, uint32_t channel_count, uint32_t capacity,
+                     float minimum, float maximum)
+{
+    if (channel_count == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0 || capacity > (1u << 30))
+    {
+        return false;
+    }
+
+    size_t record_size = get_record_size(channel_count);
+    size_t size = sizeof(struct ShmRingHeader) + (size_t)capacity * record_size;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool mapped = ftruncate(fd, size) == 0 && map_ring(ring, fd, size, PROT_READ | PROT_WRITE);
+    close(fd);
+    if (!mapped)
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    // The mapping starts zeroed, a consumer sees ready only once the header is complete
+    struct ShmRingHeader *header = ring->header;
+    memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+    header->version = SHM_RING_VERSION;
+    header->channel_count = channel_count;
+    header->capacity = capacity;
+    header->record_size = record_size;
+    header->minimum = minimum;
+    header->maximum = maximum;
+    atomic_init(&header->head, 0);
+    atomic_init(&header->dropped, 0);
+    atomic_init(&header->tail, 0);
+    atomic_store_explicit(&header->ready, 1, memory_order_release);
+    ring->position = 0;
+
+    return true;
+}
+
+bool shm_ring_open(struct ShmRing *ring, const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    bool mapped = fstat(fd, &status) == 0 && (size_t)status.st_size >= sizeof(struct ShmRingHeader) &&
+                  map_ring(ring, fd, status.st_size, PROT_READ | PROT_WRITE);
+    close(fd);
+    if (!mapped)
+    {
+        return false;
+    }
+
+    const struct ShmRingHeader *header = ring->header;
+    if (atomic_load_explicit(&ring->header->ready, memory_order_acquire) != 1 ||
+        memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) != 0 || header->version != SHM_RING_VERSION ||
+        header->channel_count == 0 || header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+        header->record_size < get_record_size(header->channel_count) ||
+        sizeof(struct ShmRingHeader) + (size_t)header->capacity * header->record_size > ring->size)
+    {
+        shm_ring_close(ring);
+        return false;
+    }
+
+    ring->position = atomic_load_explicit(&ring->header->tail, memory_order_relaxed);
+
+    return true;
+}
+
+void shm_ring_close(struct ShmRing *ring)
+{
+    if (ring->header)
+    {
+        munmap(ring->header, ring->size);
+    }
+
+    ring->header = NULL;
+    ring->records = NULL;
+    ring->size = 0;
+}
+
+static struct ShmRingRecord *get_record(const struct ShmRing *ring, uint32_t index)
+{
+    return (struct ShmRingRecord *)(ring->records + (size_t)(index & (ring->header->capacity - 1)) * ring->header->record_size);
+}
+
+bool shm_ring_push(struct ShmRing *ring, int64_t time_ns, const float *values)
+{
+    struct ShmRingHeader *header = ring->header;
+    uint32_t tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+    if (ring->position - tail >= header->capacity)
+    {
+        atomic_fetch_add_explicit(&header->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    struct ShmRingRecord *record = get_record(ring, ring->position);
+    record->time_ns = time_ns;
+    memcpy(record->values, values, header->channel_count * sizeof(float));
+
+    ring->position++;
+    atomic_store_explicit(&header->head, ring->position, memory_order_release);
+
+    return true;
+}
+
+uint32_t shm_ring_available(const struct ShmRing *ring)
+{
+    return atomic_load_explicit(&ring->header->head, memory_order_acquire) - ring->position;
+}
+
+const struct ShmRingRecord *shm_ring_peek(const struct ShmRing *ring, uint32_t index)
+{
+    return get_record(ring, ring->position + index);
+}
+
+void shm_ring_consume(struct ShmRing *ring, uint32_t count)
+{
+    ring->position += count;
+    atomic_store_explicit(&ring->header->tail, ring->position, memory_order_release);
+}
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHM_RING_MAGIC "NMRING\0\0"
+#define SHM_RING_VERSION 2
+
+// Header at the start of the shared memory object, followed by capacity
+// records of record_size bytes. head is only written by the producer and tail
+// only by the consumer, each on its own cache line.
+struct ShmRingHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channel_count;
+    // Number of records, a power of two
+    uint32_t capacity;
+    uint32_t record_size;
+    // Values are mapped from [minimum, maximum] to [0, 1]
+    float minimum;
+    float maximum;
+    // Set once the rest of the header is written, read it before the header
+    _Atomic uint32_t ready;
+
+    // Records published by the producer
+    _Alignas(64) _Atomic uint32_t head;
+    // Records the producer discarded because the ring was full
+    _Atomic uint32_t dropped;
+
+    // Records consumed by the consumer
+    _Alignas(64) _Atomic uint32_t tail;
+};
+
+struct ShmRingRecord
+{
+    // CLOCK_MONOTONIC time at which the producer published the record
+    int64_t time_ns;
+    float values[];
+};
+
+struct ShmRing
+{
+    struct ShmRingHeader *header;
+    uint8_t *records;
+    size_t size;
+    // Local copy of the index only this side writes
+    uint32_t position;
+};
+
+// Creates the shared memory object name for the producer side
+bool shm_ring_create(struct ShmRing *ring, const char *name, uint32_t channel_count, uint32_t capacity,
+                     float minimum, float maximum);
+// Maps the existing shared memory object name for the consumer side
+bool shm_ring_open(struct ShmRing *ring, const char *name);
+void shm_ring_close(struct ShmRing *ring);
+
+// Publishes a record with a value per channel, false if the ring is full
+bool shm_ring_push(struct ShmRing *ring, int64_t time_ns, const float *values);
+
+// Records ready to be consumed
+uint32_t shm_ring_available(const struct ShmRing *ring);
+// The index-th record ready to be consumed
+const struct ShmRingRecord *shm_ring_peek(const struct ShmRing *ring, uint32_t index);
+// Hands the space of the oldest count records back to the producer
+void shm_ring_consume(struct ShmRing *ring, uint32_t count);
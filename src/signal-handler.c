@@ -3,17 +3,63 @@
 
 #include "signal-handler.h"
 
-#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include "common.h"
+#include "event-loop.h"
+
+/*
+ * Signal handler
+ *
+ * SIGINT and SIGTERM are blocked and received through a signalfd in the
+ * event loop, so a wait for a deadline ends as soon as one arrives. Threads
+ * inherit the blocked signals, which is why this has to run before any
+ * thread (including the ones of the GL driver) is started.
+ */
 
 volatile sig_atomic_t sigint_triggered = 0;
 
-static void sig_handler(int _)
+static int signal_fd = -1;
+
+static void read_signals()
+{
+    struct signalfd_siginfo info;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+    {
+        sigint_triggered = 1;
+    }
+}
+
+bool initialize_signal_handler()
 {
-    (void)_;
-    sigint_triggered = 1;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != 0)
+    {
+        print_error("Could not block SIGINT and SIGTERM\n");
+        return false;
+    }
+
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0)
+    {
+        print_error("Could not create signalfd\n");
+        return false;
+    }
+
+    return add_event_source(signal_fd, read_signals);
 }
 
-void initialize_signal_handler()
+void cleanup_signal_handler()
 {
-    signal(SIGINT, sig_handler);
+    if (signal_fd >= 0)
+    {
+        remove_event_source(signal_fd);
+        close(signal_fd);
+        signal_fd = -1;
+    }
 }
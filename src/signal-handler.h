@@ -4,7 +4,11 @@
 #pragma once
 
 #include <signal.h>
+#include <stdbool.h>
 
+// Set once SIGINT or SIGTERM was received
 extern volatile sig_atomic_t sigint_triggered;
 
-void initialize_signal_handler();
+// Has to run before any thread is created, the event loop has to be initialized
+bool initialize_signal_handler();
+void cleanup_signal_handler();
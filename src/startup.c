@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "startup.h"
+
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+
+/*
+ * Startup profile
+ *
+ * Breaks the time from the process start to the first presented frame down
+ * into stages. Each stage ends when startup_stage_finished() is called.
+ */
+
+#define MAX_STARTUP_STAGES 32
+
+static struct StartupStage stages[MAX_STARTUP_STAGES];
+static size_t stages_count = 0;
+static int64_t process_started_ns;
+static int64_t last_stage_ns;
+static bool finished = false;
+
+static int64_t get_boot_time_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return (int64_t)now.tv_sec * (int64_t)SEC_IN_NS + now.tv_nsec;
+}
+
+// Process start in CLOCK_BOOTTIME (only at clock tick resolution)
+static bool get_process_start_ns(int64_t *started_ns)
+{
+    FILE *file = fopen("/proc/self/stat", "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[1024];
+    bool success = fgets(line, sizeof(line), file) != NULL;
+    fclose(file);
+
+    // The command name may contain spaces, the fields are counted after it
+    char *fields = success ? strrchr(line, ')') : NULL;
+    unsigned long long start_ticks;
+    if (!fields || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+    {
+        return false;
+    }
+
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+    (*started_ns) = (int64_t)(start_ticks * SEC_IN_NS / ticks_per_second);
+
+    return true;
+}
+
+void initialize_startup_profile()
+{
+    int64_t now = get_boot_time_ns();
+
+    stages_count = 0;
+    finished = false;
+
+    if (get_process_start_ns(&process_started_ns) && process_started_ns <= now)
+    {
+        last_stage_ns = process_started_ns;
+        startup_stage_finished("process start to main");
+    }
+    else
+    {
+        process_started_ns = now;
+        last_stage_ns = now;
+    }
+}
+
+void startup_stage_finished(const char *name)
+{
+    if (finished || stages_count >= MAX_STARTUP_STAGES)
+    {
+        return;
+    }
+
+    int64_t now = get_boot_time_ns();
+
+    struct StartupStage stage = {name, now - last_stage_ns, now - process_started_ns};
+    stages[stages_count++] = stage;
+    last_stage_ns = now;
+}
+
+void finish_startup_profile()
+{
+    startup_stage_finished("first frame presented");
+    finished = true;
+}
+
+bool is_startup_finished()
+{
+    return finished;
+}
+
+void print_startup_profile()
+{
+    if (stages_count == 0)
+    {
+        return;
+    }
+
+    print("Startup\n");
+    print("-------\n");
+    for (size_t i = 0; i < stages_count; i++)
+    {
+        print("%-28s %10.3f ms %10.3f ms\n", stages[i].name, stages[i].duration_ns / 1e6, stages[i].finished_ns / 1e6);
+    }
+    print("\n");
+}
+
+size_t get_startup_stages(const struct StartupStage **_stages)
+{
+    (*_stages) = stages;
+    return stages_count;
+}
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct StartupStage
+{
+    const char *name;
+    int64_t duration_ns;
+    // Time from the process start to the end of the stage
+    int64_t finished_ns;
+};
+
+void initialize_startup_profile();
+void startup_stage_finished(const char *name);
+void finish_startup_profile();
+bool is_startup_finished();
+void print_startup_profile();
+size_t get_startup_stages(const struct StartupStage **stages);
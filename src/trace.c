@@ -0,0 +1,203 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include "trace.h"
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "common.h"
+
+/*
+ * Tracing
+ *
+ * Every thread records spans into its own ring buffer, so recording needs
+ * neither locks nor allocations. The buffers are exported as Chrome trace
+ * event JSON (chrome://tracing, ui.perfetto.dev) at exit.
+ */
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+struct TraceBuffer
+{
+    const char *thread_name;
+    pid_t tid;
+    uint64_t written;
+    struct TraceEvent events[TRACE_BUFFER_EVENTS];
+    struct TraceBuffer *next;
+};
+
+bool trace_enabled = false;
+
+static const char *trace_path = NULL;
+static int64_t trace_started_ns;
+static struct TraceBuffer *buffers = NULL;
+static pthread_mutex_t buffers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct TraceBuffer *thread_buffer = NULL;
+
+int64_t trace_now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * (int64_t)SEC_IN_NS + now.tv_nsec;
+}
+
+bool initialize_trace(const char *path)
+{
+    trace_path = path;
+    trace_started_ns = trace_now_ns();
+    trace_enabled = true;
+
+    trace_register_thread("main");
+
+    if (!thread_buffer)
+    {
+        trace_enabled = false;
+        return false;
+    }
+
+    return true;
+}
+
+void trace_register_thread(const char *thread_name)
+{
+    if (!trace_enabled || thread_buffer)
+    {
+        return;
+    }
+
+    struct TraceBuffer *buffer = calloc(1, sizeof(struct TraceBuffer));
+    if (!buffer)
+    {
+        print_error("Failed to allocate trace buffer\n");
+        return;
+    }
+
+    buffer->thread_name = thread_name;
+    buffer->tid = (pid_t)syscall(SYS_gettid);
+
+    pthread_mutex_lock(&buffers_mutex);
+    buffer->next = buffers;
+    buffers = buffer;
+    pthread_mutex_unlock(&buffers_mutex);
+
+    thread_buffer = buffer;
+}
+
+void trace_record(const char *name, int64_t start_ns, int64_t end_ns)
+{
+    struct TraceBuffer *buffer = thread_buffer;
+    if (!buffer)
+    {
+        // Threads which have not been registered are not traced
+        return;
+    }
+
+    struct TraceEvent *event = &buffer->events[buffer->written % TRACE_BUFFER_EVENTS];
+    event->name = name;
+    event->start_ns = start_ns;
+    event->duration_ns = end_ns - start_ns;
+    buffer->written++;
+}
+
+static void write_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (const char *c = string; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+
+        if ((unsigned char)*c >= 0x20)
+        {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static bool write_trace()
+{
+    FILE *file = fopen(trace_path, "w");
+    if (!file)
+    {
+        print_error("Could not open trace file '%s'\n", trace_path);
+        return false;
+    }
+
+    pid_t pid = getpid();
+    uint64_t dropped = 0;
+    bool first = true;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&buffers_mutex);
+    for (struct TraceBuffer *buffer = buffers; buffer; buffer = buffer->next)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":",
+                first ? "" : ",\n", pid, buffer->tid);
+        write_string(file, buffer->thread_name);
+        fprintf(file, "}}");
+        first = false;
+
+        uint64_t count = buffer->written < TRACE_BUFFER_EVENTS ? buffer->written : TRACE_BUFFER_EVENTS;
+        dropped += buffer->written - count;
+
+        for (uint64_t i = buffer->written - count; i < buffer->written; i++)
+        {
+            struct TraceEvent *event = &buffer->events[i % TRACE_BUFFER_EVENTS];
+
+            fprintf(file, ",\n{\"name\":");
+            write_string(file, event->name);
+            fprintf(file, ",\"cat\":\"nightmare\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%i,\"tid\":%i}",
+                    (event->start_ns - trace_started_ns) / 1e3, event->duration_ns / 1e3, pid, buffer->tid);
+        }
+    }
+    pthread_mutex_unlock(&buffers_mutex);
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    print("Trace written to '%s'", trace_path);
+    if (dropped > 0)
+    {
+        print(" (%llu oldest events dropped)", (unsigned long long)dropped);
+    }
+    print("\n");
+
+    return true;
+}
+
+void cleanup_trace()
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+
+    trace_enabled = false;
+    write_trace();
+
+    pthread_mutex_lock(&buffers_mutex);
+    struct TraceBuffer *buffer = buffers;
+    while (buffer)
+    {
+        struct TraceBuffer *next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    buffers = NULL;
+    pthread_mutex_unlock(&buffers_mutex);
+
+    thread_buffer = NULL;
+}
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of events kept per thread, older events are overwritten
+#define TRACE_BUFFER_EVENTS 65536
+
+struct TraceSpan
+{
+    const char *name;
+    int64_t start_ns;
+};
+
+extern bool trace_enabled;
+
+bool initialize_trace(const char *path);
+void cleanup_trace();
+void trace_register_thread(const char *thread_name);
+
+void trace_record(const char *name, int64_t start_ns, int64_t end_ns);
+int64_t trace_now_ns();
+
+// Span names have to be string literals or otherwise outlive the trace
+static inline struct TraceSpan trace_begin(const char *name)
+{
+    struct TraceSpan span = {name, trace_enabled ? trace_now_ns() : 0};
+    return span;
+}
+
+static inline void trace_end(struct TraceSpan *span)
+{
+    if (trace_enabled)
+    {
+        trace_record(span->name, span->start_ns, trace_now_ns());
+    }
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+# SPDX-License-Identifier: MIT
+#
+# Runs a benchmark binary offscreen for a fixed frame count and compares the
+# frame times against the baseline stored for this machine. The first run (or
+# a run with NIGHTMARE_UPDATE_BASELINE=1) stores the baseline instead. The
+# allowed slowdown of the median frame time defaults to 10 percent and can be
+# changed with NIGHTMARE_THRESHOLD.
+#
+# Usage: benchmark.sh BENCHMARK COMPARE NAME [BENCHMARK OPTIONS...]
+
+set -e
+
+benchmark="$1"
+compare="$2"
+name="$3"
+shift 3
+
+baseline_dir="${NIGHTMARE_BASELINE_DIR:-${XDG_DATA_HOME:-$HOME/.local/share}/nightmare/baselines/$(hostname)}"
+baseline="$baseline_dir/$name.txt"
+results="$(mktemp)"
+trap 'rm -f "$results"' EXIT
+
+"$benchmark" --offscreen 640x480 --frames 1200 --results "$results" "$@"
+
+if [ ! -f "$baseline" ] || [ "$NIGHTMARE_UPDATE_BASELINE" = "1" ]
+then
+  mkdir -p "$baseline_dir"
+  cp "$results" "$baseline"
+  echo "Stored baseline $baseline"
+  exit 0
+fi
+
+"$compare" --threshold "${NIGHTMARE_THRESHOLD:-10}" "$baseline" "$results"
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+
+#include "damage.h"
+
+/*
+ * Damage tracking test
+ *
+ * The render tests draw into pbuffers, which have no buffer age, so they only
+ * run the full redraw fallback. This checks the repaint regions for back
+ * buffers of different ages directly.
+ */
+
+// Read by the damage tracking instead of the EGL surface size
+int screen_width = 320;
+int screen_height = 240;
+
+static int failures = 0;
+
+static void expect_region(int line, int buffer_age, int x, int y, int width, int height)
+{
+    struct DamageRect region;
+    if (!damage_get_repaint_region(buffer_age, &region))
+    {
+        printf("line %i: no repaint region for buffer age %i\n", line, buffer_age);
+        failures++;
+    }
+    else if (region.x != x || region.y != y || region.width != width || region.height != height)
+    {
+        printf("line %i: buffer age %i repaints %i,%i %ix%i instead of %i,%i %ix%i\n", line, buffer_age,
+               region.x, region.y, region.width, region.height, x, y, width, height);
+        failures++;
+    }
+}
+
+static void expect_no_region(int line, int buffer_age)
+{
+    struct DamageRect region;
+    if (damage_get_repaint_region(buffer_age, &region))
+    {
+        printf("line %i: buffer age %i has a repaint region, the buffer content is unknown\n", line, buffer_age);
+        failures++;
+    }
+}
+
+static void expect(int line, bool condition, const char *description)
+{
+    if (!condition)
+    {
+        printf("line %i: %s\n", line, description);
+        failures++;
+    }
+}
+
+int main()
+{
+    // Nothing has been drawn yet, every buffer is repainted completely
+    damage_reset();
+    expect_region(__LINE__, 1, 0, 0, 320, 240);
+    expect_no_region(__LINE__, 0);
+    expect_no_region(__LINE__, 2);
+    damage_finish_frame();
+    expect(__LINE__, damage_is_empty(), "damage remains after the frame finished");
+
+    // A buffer of age n misses the damage of the last n - 1 frames
+    damage_add_rect(10, 20, 30, 40);
+    expect_region(__LINE__, 1, 10, 20, 30, 40);
+    expect_region(__LINE__, 2, 0, 0, 320, 240);
+    damage_finish_frame();
+
+    damage_add_rect(100, 100, 10, 10);
+    damage_add_rect(150, 50, 10, 10);
+    expect_region(__LINE__, 1, 100, 50, 60, 60);
+    expect_region(__LINE__, 2, 10, 20, 150, 90);
+    expect_region(__LINE__, 3, 0, 0, 320, 240);
+    expect_no_region(__LINE__, 4);
+    damage_finish_frame();
+
+    // The runner presents no frame while nothing is damaged, so the buffers
+    // do not age until the next damaged frame
+    expect(__LINE__, damage_is_empty(), "a new frame starts with damage");
+    damage_add_rect(0, 0, 1, 1);
+    expect_region(__LINE__, 1, 0, 0, 1, 1);
+    expect_region(__LINE__, 2, 0, 0, 160, 110);
+    expect_region(__LINE__, 3, 0, 0, 160, 110);
+    expect_region(__LINE__, 4, 0, 0, 320, 240);
+    damage_finish_frame();
+
+    // Rectangles are clipped to the screen
+    damage_add_rect(-10, 230, 30, 30);
+    expect_region(__LINE__, 1, 0, 230, 20, 10);
+    damage_finish_frame();
+
+    // Normalized device coordinates with a margin in pixels
+    damage_add_ndc_rect(0.0f, 0.0f, 0.5f, 0.5f, 2);
+    expect_region(__LINE__, 1, 158, 118, 84, 64);
+    damage_finish_frame();
+
+    // Only the damage of the last frames is kept
+    for (int frame = 0; frame < 16; frame++)
+    {
+        damage_add_rect(frame, 0, 1, 1);
+        damage_finish_frame();
+    }
+    damage_add_rect(100, 0, 1, 1);
+    expect_region(__LINE__, 1, 100, 0, 1, 1);
+    expect_region(__LINE__, 2, 15, 0, 86, 1);
+    expect_region(__LINE__, 9, 8, 0, 93, 1);
+    expect_no_region(__LINE__, 10);
+
+    // Full damage covers every older buffer
+    damage_add_full();
+    expect_region(__LINE__, 5, 0, 0, 320, 240);
+
+    if (failures > 0)
+    {
+        printf("%i damage tracking checks failed\n", failures);
+        return 1;
+    }
+
+    printf("Damage tracking checks passed\n");
+    return 0;
+}
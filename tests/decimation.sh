@@ -0,0 +1,27 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+# SPDX-License-Identifier: MIT
+#
+# Runs the graph scenes with several samples per pixel column, which a
+# producer process publishes, and checks that the decimated lines look like
+# the undecimated ones.
+#
+# Usage: decimation.sh BINARY PRODUCER DECIMATION
+
+set -e
+
+binary="$1"
+producer="$2"
+decimation="$3"
+
+. "$(dirname "$0")/producer.sh"
+start_producer "$producer" --channels 2 --rate 50000 --burst 50
+
+# 1000 samples per line are about three per column, the lines fill up within the first 2000 frames
+"$binary" --offscreen 320x240 --frames 2000 --verify-output --ingest "$name" --results "$results" \
+    --scene Floating --scene Fixed --load 2x1000 --decimation "$decimation" --decimation-check
+
+test "$(grep -c "^parameter	decimation	$decimation$" "$results")" -eq 2
+# Every scene draws with less than 5% of its pixels changed by the decimation
+test "$(grep -c "^metric	decimation_error_percent	" "$results")" -eq 2
+grep "^metric	decimation_error_percent	" "$results" | awk -F '\t' '$3 >= 5.0 { exit 1 }'
@@ -0,0 +1,23 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+# SPDX-License-Identifier: MIT
+#
+# Runs the scenes on samples a producer process publishes in bursts through a
+# shared memory ring and checks that the samples arrived.
+#
+# Usage: ingest.sh BINARY PRODUCER
+
+set -e
+
+binary="$1"
+producer="$2"
+
+. "$(dirname "$0")/producer.sh"
+start_producer "$producer" --rate 20000 --burst 20
+
+"$binary" --offscreen 320x240 --frames 600 --ingest "$name" --results "$results"
+
+grep -q "^environment	data	ingest$" "$results"
+grep -q "^metric	ingest_max_latency_ms	" "$results"
+# At least one scene has to see samples, they arrive every millisecond
+grep "^metric	ingested_samples_per_second	" "$results" | grep -qv "	0\.0*$"
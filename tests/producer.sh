@@ -0,0 +1,27 @@
+# SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+# SPDX-License-Identifier: MIT
+#
+# Sourced by the tests which ingest samples. start_producer runs a producer
+# process which publishes into the shared memory ring named by $name and
+# returns once the ring is complete. The producer, $results and its log are
+# removed when the test exits.
+#
+# Usage: start_producer PRODUCER [PRODUCER OPTIONS]
+
+name="/nightmare-test-$$"
+results="$(mktemp)"
+producer_log="$(mktemp)"
+
+start_producer() {
+    producer_binary="$1"
+    shift
+    "$producer_binary" --name "$name" --duration 120 "$@" > "$producer_log" &
+    producer_pid=$!
+    trap 'kill $producer_pid 2> /dev/null; wait $producer_pid; rm -f "$results" "$producer_log"' EXIT
+
+    # The ring is complete once the producer announces it
+    for attempt in $(seq 50); do
+        grep -q "^Producing" "$producer_log" && return
+        sleep 0.1
+    done
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: 2023 Sahithyen Kanaganayagam <mail@sahithyen.com>
+# SPDX-License-Identifier: MIT
+#
+# Samples the sensors of a fake sysfs tree whose second CPU is capped below
+# its maximum frequency, so every frame has to be flagged as throttled.
+#
+# Usage: sensors.sh BINARY SYSFS_ROOT
+
+set -e
+
+binary="$1"
+sysfs_root="$2"
+results="$(mktemp)"
+trap 'rm -f "$results"' EXIT
+
+"$binary" --offscreen 320x240 --frames 120 --sensors --sysfs-root "$sysfs_root" --sensor-interval 5 --results "$results"
+
+grep -q "^sensor-columns	time_ns	throttled	cpu0_khz	cpu1_khz	thermal_zone0_mc	13000000.gpu_hz$" "$results"
+grep -q "^metric	throttled_frames	120\.0*$" "$results"
+grep -q "^metric	max_temperature_c	62\.50*$" "$results"
+grep -q "^metric	min_cpu_mhz	1200\.0*$" "$results"